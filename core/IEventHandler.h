@@ -7,19 +7,21 @@ struct Action {
 	enum class Type {
 		None,
 		Move,
-		Attack
+		Attack,
+		EndTurn
 	};
 
 	Action(): type(Type::None) { }
-	Action(Unit& unit, Pos2 pos, int segment):
-		unit(&unit), type(Type::Move), pos(pos), segment(segment) { }
-	Action(Unit& unit, Weapon& weapon, const Unit* target = nullptr):
-		unit(&unit), type(Type::Attack), pos(target == nullptr ? Pos2() : target->pos()), weapon(&weapon) { }
+	explicit Action(Type type): type(type) { }
+	Action(const Unit& unit, Pos2 pos, int segment):
+		unit(unit.handle()), type(Type::Move), pos(pos), segment(segment) { }
+	Action(const Unit& unit, Weapon& weapon, const Unit& target = Unit()):
+		unit(unit.handle()), type(Type::Attack), pos(target ? target.pos() : Pos2()), weapon(&weapon) { }
 
 
 	Type type;
 
-	Unit* unit = nullptr;
+	UnitHandle unit;
 	Pos2 pos;
 	int segment = 0;
 	Weapon* weapon = nullptr;
@@ -27,9 +29,10 @@ struct Action {
 
 class IEventHandler {
 public:
-	virtual void on_select(Unit* unit) = 0;
+	virtual void on_select(UnitHandle unit) = 0;
 	virtual void on_action(Action action) = 0;
-	virtual int get_probability(Unit& unit, Weapon& weapon, Unit& target) = 0;
+	/// Chance in percent of the weapon hitting, or -1 if the target is not a visible enemy in range.
+	virtual int get_probability(const Unit& unit, Weapon& weapon, const Unit& target) = 0;
 };
 
 #endif //SPENCE_IEVENTHANDLER_H
@@ -0,0 +1,86 @@
+#include "MovementPool.h"
+#include <algorithm>
+
+bool MovementPool::hold(UnitHandle unit, Pos2 from) {
+	if (find(unit)) return true;
+	if (movements.size() >= MAX_MOVEMENTS) return false;
+	movements.emplace_back();
+	Movement& movement = movements.back();
+	movement.unit = unit;
+	movement.points[0] = from;
+	movement.num_points = 1;
+	return true;
+}
+
+void MovementPool::start(UnitHandle unit, const std::vector<Pos2>& waypoints, double now) {
+	Movement* movement = find(unit);
+	if (!movement || waypoints.empty()) return;
+	if (movement->start < 0 || is_done(*movement, now)) {
+		// start over from where it's standing, so it doesn't skip ahead by the time it stood still
+		movement->points[0] = movement->points[movement->num_points - 1];
+		movement->num_points = 1;
+		movement->start = now;
+	}
+
+	Pos2& last = movement->points[movement->num_points - 1];
+	size_t first = waypoints.front() == last ? 1 : 0;
+	size_t count = waypoints.size() - first;
+	size_t room = MAX_WAYPOINTS - movement->num_points;
+	if (room == 0) {
+		last = waypoints.back();
+		return;
+	}
+	size_t take = std::min(count, room);
+	for (size_t k = 1; k <= take; k++) {
+		// evenly spaced through the new points, always ending on the last one
+		movement->points[movement->num_points++] = waypoints[first + k * count / take - 1];
+	}
+}
+
+void MovementPool::stop(UnitHandle unit) {
+	Movement* movement = find(unit);
+	if (!movement) return;
+	*movement = movements.back();
+	movements.pop_back();
+}
+
+void MovementPool::expire(double now) {
+	movements.erase(std::remove_if(movements.begin(), movements.end(), [now](const Movement& movement) {
+		return is_done(movement, now);
+	}), movements.end());
+}
+
+bool MovementPool::is_animating(double now) const {
+	for (const Movement& movement : movements) {
+		if (!is_done(movement, now)) return true;
+	}
+	return false;
+}
+
+MovementPool::Movement* MovementPool::find(UnitHandle unit) {
+	for (Movement& movement : movements) {
+		if (movement.unit == unit) return &movement;
+	}
+	return nullptr;
+}
+
+bool MovementPool::is_done(const Movement& movement, double now) {
+	if (movement.start < 0) return false;
+	double length = 0;
+	for (size_t i = 1; i < movement.num_points; i++) {
+		length += Vec2(movement.points[i] - movement.points[i - 1]).length();
+	}
+	return (now - movement.start) * SPEED >= length;
+}
+
+Vec2 MovementPool::position(const Movement& movement, double now) {
+	double dist = movement.start < 0 ? 0 : (now - movement.start) * SPEED;
+	for (size_t i = 1; i < movement.num_points; i++) {
+		Vec2 from(movement.points[i - 1]);
+		Vec2 step = Vec2(movement.points[i]) - from;
+		double length = step.length();
+		if (dist < length) return from + step * (dist / length);
+		dist -= length;
+	}
+	return Vec2(movement.points[movement.num_points - 1]);
+}
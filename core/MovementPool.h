@@ -0,0 +1,62 @@
+#ifndef SPENCE_MOVEMENTPOOL_H
+#define SPENCE_MOVEMENTPOOL_H
+
+#include <array>
+#include <vector>
+#include "UnitStore.h"
+
+/// Units sliding along their paths after moving, for drawing. Capacity is reserved up front and
+/// each movement keeps its waypoints inline, so starting, advancing and copying movements never
+/// allocates; a unit that doesn't fit simply appears at its destination. Times are in seconds.
+class MovementPool {
+public:
+	static const size_t MAX_MOVEMENTS = 1024;
+	static const size_t MAX_WAYPOINTS = 32;
+	/// Tiles per second.
+	static constexpr double SPEED = 8;
+
+	MovementPool() {
+		movements.reserve(MAX_MOVEMENTS);
+	}
+
+	/// Keeps the unit drawn at from until start() gives it a path. A unit that's already moving
+	/// carries on where it is. Returns false if the pool is full.
+	bool hold(UnitHandle unit, Pos2 from);
+	/// Sends a held unit along the waypoints, the first of which is where it was held, or
+	/// appends them to its current path. Paths longer than MAX_WAYPOINTS are thinned out.
+	void start(UnitHandle unit, const std::vector<Pos2>& waypoints, double now);
+	void stop(UnitHandle unit);
+	/// Drops movements that have reached their destination.
+	void expire(double now);
+	inline void clear() {
+		movements.clear();
+	}
+
+	/// Whether anything is still held or moving, so frames need drawing to show it.
+	bool is_animating(double now) const;
+
+	/// Calls fn(UnitHandle, Vec2 pos) for every unit being animated, with its top left in tiles.
+	template<typename F>
+	void for_each(double now, F fn) const {
+		for (const Movement& movement : movements) {
+			fn(movement.unit, position(movement, now));
+		}
+	}
+
+private:
+	struct Movement {
+		UnitHandle unit;
+		double start = -1;  // negative while held
+		size_t num_points = 0;
+		std::array<Pos2, MAX_WAYPOINTS> points;
+	};
+
+	Movement* find(UnitHandle unit);
+	static bool is_done(const Movement& movement, double now);
+	static Vec2 position(const Movement& movement, double now);
+
+	std::vector<Movement> movements;
+};
+
+
+#endif //SPENCE_MOVEMENTPOOL_H
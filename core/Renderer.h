@@ -3,7 +3,7 @@
 
 #include "map/Tile.h"
 #include "Unit.h"
-#include "map/Grid.h"
+#include "map/CowGrid.h"
 
 enum class Key {
 	UNKNOWN = -1,
@@ -17,7 +17,7 @@ enum class Mouse {
 class Renderer {
 public:
 	virtual void render() = 0;
-	virtual void reset_grid(const Grid<Tile>& grid) = 0;
+	virtual void reset_grid(const CowGrid<Tile>& grid) = 0;
 
 	virtual void resize(Pos2 size) { }
 	virtual void mouse_move(Pos2 pos) { }
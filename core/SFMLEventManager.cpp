@@ -1,4 +1,10 @@
 #include "SFMLEventManager.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// how often to look for events while idle; SFML can't wait for one with a timeout
+#define IDLE_SLICE_MS 5
 
 SFMLEventManager::SFMLEventManager(SFMLRenderer& renderer): renderer(renderer) { }
 
@@ -22,56 +28,69 @@ Mouse sfml_to_mouse(sf::Mouse::Button mouse) {
 		default: return Mouse::UNKNOWN;
 	}
 }
-bool SFMLEventManager::update() {
+bool SFMLEventManager::update(int idle_ms) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(idle_ms);
 	sf::Event event;
-	while (renderer.get_window().pollEvent(event)) {
-		switch (event.type) {
-			case sf::Event::Closed:
-				renderer.get_window().close();
-				return true;
-			case sf::Event::Resized:
-				renderer.resize(Pos2(event.size.width, event.size.height));
-				break;
-			case sf::Event::LostFocus:
-				renderer.pause();
-				break;
-			case sf::Event::GainedFocus:
-				renderer.unpause();
-				break;
-			case sf::Event::KeyPressed:
-				if (event.key.code >= sf::Keyboard::F1 && event.key.code <= sf::Keyboard::F15) {
-					renderer.fkey_press(event.key.code - sf::Keyboard::F1 + 1);
-				} else if (event.key.code >= sf::Keyboard::Num0 &&
-				           event.key.code <= sf::Keyboard::Num9) {
-					renderer.numkey_press(event.key.code - sf::Keyboard::Num0);
-				} else if (event.key.code >= sf::Keyboard::Numpad0 &&
-				           event.key.code <= sf::Keyboard::Numpad9) {
-					renderer.numkey_press(event.key.code - sf::Keyboard::Numpad0);
-				} else {
-					Key key = sfml_to_key(event.key);
-					if (key != Key::UNKNOWN) renderer.key_press(key);
-				}
-				break;
-			case sf::Event::KeyReleased: {
-				Key key = sfml_to_key(event.key);
-				if (key != Key::UNKNOWN) renderer.key_release(key);
-			} break;
-			case sf::Event::MouseMoved:
-				renderer.mouse_move(Pos2(event.mouseMove.x, event.mouseMove.y));
-				break;
-			case sf::Event::MouseWheelScrolled:
-				renderer.mouse_scroll(event.mouseWheelScroll.delta);
-				break;
-			case sf::Event::MouseButtonPressed:
-				renderer.mouse_press(Pos2(event.mouseButton.x, event.mouseButton.y),
-				                     sfml_to_mouse(event.mouseButton.button));
-				break;
-			case sf::Event::MouseButtonReleased:
-				renderer.mouse_release(Pos2(event.mouseButton.x, event.mouseButton.y),
-				                       sfml_to_mouse(event.mouseButton.button));
-				break;
-			default: break;
+	while (true) {
+		bool handled = false;
+		while (renderer.get_window().pollEvent(event)) {
+			handled = true;
+			if (handle(event)) return true;
 		}
+		auto now = std::chrono::steady_clock::now();
+		if (handled || now >= deadline) return false;
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+			deadline - now, std::chrono::milliseconds(IDLE_SLICE_MS)));
+	}
+}
+
+bool SFMLEventManager::handle(const sf::Event& event) {
+	switch (event.type) {
+		case sf::Event::Closed:
+			renderer.close();
+			return true;
+		case sf::Event::Resized:
+			renderer.resize(Pos2(event.size.width, event.size.height));
+			break;
+		case sf::Event::LostFocus:
+			renderer.pause();
+			break;
+		case sf::Event::GainedFocus:
+			renderer.unpause();
+			break;
+		case sf::Event::KeyPressed:
+			if (event.key.code >= sf::Keyboard::F1 && event.key.code <= sf::Keyboard::F15) {
+				renderer.fkey_press(event.key.code - sf::Keyboard::F1 + 1);
+			} else if (event.key.code >= sf::Keyboard::Num0 &&
+			           event.key.code <= sf::Keyboard::Num9) {
+				renderer.numkey_press(event.key.code - sf::Keyboard::Num0);
+			} else if (event.key.code >= sf::Keyboard::Numpad0 &&
+			           event.key.code <= sf::Keyboard::Numpad9) {
+				renderer.numkey_press(event.key.code - sf::Keyboard::Numpad0);
+			} else {
+				Key key = sfml_to_key(event.key);
+				if (key != Key::UNKNOWN) renderer.key_press(key);
+			}
+			break;
+		case sf::Event::KeyReleased: {
+			Key key = sfml_to_key(event.key);
+			if (key != Key::UNKNOWN) renderer.key_release(key);
+		} break;
+		case sf::Event::MouseMoved:
+			renderer.mouse_move(Pos2(event.mouseMove.x, event.mouseMove.y));
+			break;
+		case sf::Event::MouseWheelScrolled:
+			renderer.mouse_scroll(event.mouseWheelScroll.delta);
+			break;
+		case sf::Event::MouseButtonPressed:
+			renderer.mouse_press(Pos2(event.mouseButton.x, event.mouseButton.y),
+			                     sfml_to_mouse(event.mouseButton.button));
+			break;
+		case sf::Event::MouseButtonReleased:
+			renderer.mouse_release(Pos2(event.mouseButton.x, event.mouseButton.y),
+			                       sfml_to_mouse(event.mouseButton.button));
+			break;
+		default: break;
 	}
 	return false;
 }
@@ -6,9 +6,13 @@
 class SFMLEventManager {
 public:
 	SFMLEventManager(SFMLRenderer& renderer);
-	bool update();
+	/// Handles pending events. With no events pending, waits up to idle_ms for one to arrive.
+	/// Returns true if the window was closed.
+	bool update(int idle_ms = 0);
 
 private:
+	bool handle(const sf::Event& event);
+
 	SFMLRenderer& renderer;
 };
 
@@ -1,8 +1,20 @@
 #include "SFMLRenderer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 
 #define RIGHT_PANE_WIDTH 200
 #define INFO_MARGIN 20
 #define INFO_HEIGHT 20
+// how often the profiler overlay is redrawn when no new frames come in
+#define PROFILE_REFRESH_MS 250
+// pixels per tile in the atlas
+#define ATLAS_TILE 32
+// below this many pixels per tile the floor is drawn flat, in one quad instead of a draw per chunk
+#define MIN_TEXTURED_TILE 8
+// floor chunk buffers kept around before the ones out of view are released
+#define MAX_FLOOR_CHUNKS 256
 
 const sf::Color RED(255, 0, 0);
 const sf::Color ORANGE(255, 127, 0);
@@ -16,6 +28,7 @@ const sf::Color BLUE(0, 0, 255);
 const sf::Color VIOLET(127, 0, 255);
 const sf::Color MAGENTA(255, 0, 255);
 const sf::Color ROSE(255, 0, 127);
+const sf::Color FLOOR(31, 31, 31);
 
 sf::Color darken(const sf::Color& color) {
 	return sf::Color(color.r / 2, color.g / 2, color.b / 2);
@@ -25,8 +38,14 @@ sf::Color transparent(const sf::Color& color, uint8_t alpha) {
 	return sf::Color(color.r, color.g, color.b, alpha);
 }
 
+// the clock movements are animated by, shared by both threads
+static double seconds() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 SFMLRenderer::SFMLRenderer(Pos2 screen_size, float tile_size, Map& map, UI& ui, IEventHandler& handler):
-	vertex_arr(sf::PrimitiveType::Triangles), ui(ui), map(map), handler(handler), tile_size(tile_size) {
+	vertex_arr(sf::PrimitiveType::Triangles), wall_buffer(sf::PrimitiveType::Triangles, sf::VertexBuffer::Static),
+	tile_size(tile_size), ui(ui), map(map), handler(handler), unit_changes(map.get_changes().subscribe()) {
 
 	if (!font.loadFromFile("resources/Slabo27px-Regular.ttf")) {
 		std::cout << "Couldn't load font" << std::endl;
@@ -34,14 +53,67 @@ SFMLRenderer::SFMLRenderer(Pos2 screen_size, float tile_size, Map& map, UI& ui,
 
 	sf::String sf_title = sf::String("is game");
 	window.create(sf::VideoMode((unsigned)screen_size.x, (unsigned)screen_size.y), sf_title);
-	ui_texture.create(RIGHT_PANE_WIDTH, screen_size.y);
+	// only reached while dragging or the game is busy; idle frames aren't drawn at all
+	window.setFramerateLimit(60);
 
 	prev_frame = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i <= CIRCLE_POINTS; i++) {
+		double angle = TAU * (double)(i % CIRCLE_POINTS) / CIRCLE_POINTS;
+		circle_fan[i] = sf::Vector2f((float)std::cos(angle), (float)std::sin(angle));
+	}
+
+	// a GL context can only be active on one thread; events keep being polled on this one
+	window.setActive(false);
+	render_thread = std::thread(&SFMLRenderer::render_loop, this);
+}
+
+SFMLRenderer::~SFMLRenderer() {
+	stop_render_thread();
+	map.get_changes().unsubscribe(unit_changes);
+}
+
+void SFMLRenderer::close() {
+	stop_render_thread();
+	window.close();
+}
+
+void SFMLRenderer::stop_render_thread() {
+	if (!render_thread.joinable()) return;
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	render_thread.join();
 }
 
 void SFMLRenderer::update_render_pos() {
 	Vec2 offset = Vec2(window.getSize().x, window.getSize().y) / tile_size / 2;
 	render_pos = -Vec2(map.get_size()) / 2 + gridPos + offset;
+	view = sf::Transform();
+	view.scale(tile_size, tile_size).translate((float)render_pos.x, (float)render_pos.y);
+}
+
+void SFMLRenderer::update_visible(const Frame& frame) {
+	// the inverse view maps the window's corners back to tiles
+	sf::Transform to_tiles = frame.view.getInverse();
+	sf::Vector2f from = to_tiles.transformPoint(0, 0);
+	sf::Vector2f to = to_tiles.transformPoint((float)window.getSize().x, (float)window.getSize().y);
+	Pos2 map_size = frame.map->get_size();
+	visible_from = Pos2((int)std::floor(from.x), (int)std::floor(from.y)).max(Pos2()).min(map_size);
+	visible_to = Pos2((int)std::ceil(to.x), (int)std::ceil(to.y)).max(Pos2()).min(map_size);
+}
+
+static void set_quad(sf::Vertex* v, Vec2 pos, Vec2 size, sf::Color color) {
+	sf::Vector2f top_left((float)pos.x, (float)pos.y);
+	sf::Vector2f bot_rite((float)(pos.x + size.x), (float)(pos.y + size.y));
+	v[0] = sf::Vertex(top_left, color);
+	v[1] = sf::Vertex(sf::Vector2f(bot_rite.x, top_left.y), color);
+	v[2] = sf::Vertex(sf::Vector2f(top_left.x, bot_rite.y), color);
+	v[3] = sf::Vertex(sf::Vector2f(top_left.x, bot_rite.y), color);
+	v[4] = sf::Vertex(sf::Vector2f(bot_rite.x, top_left.y), color);
+	v[5] = sf::Vertex(bot_rite, color);
 }
 
 sf::Color get_segment_color(int segment, int num_segments) {
@@ -50,149 +122,492 @@ sf::Color get_segment_color(int segment, int num_segments) {
 	return darken(darken(color));
 }
 
+bool SFMLRenderer::needs_render() const {
+	return !paused && (dirty || ui.is_changed() || map.get_hash() != published_hash ||
+	                   map.get_units().get_fov_version() != published_fov_version);
+}
+
 void SFMLRenderer::render() {
 	if (paused) return;
+	update_movements();
+	if (path_jobs.poll() + move_jobs.poll() > 0) dirty = true;
+	if (!needs_render()) return;
+	publish();
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		woken = true;
+	}
+	wake.notify_one();
+}
+
+void SFMLRenderer::publish() {
+	PROFILE("render.publish");
+	dirty = false;
+	published_hash = map.get_hash();
+	published_fov_version = map.get_units().get_fov_version();
+	if (ui.has_changed()) ui_version++;
+
+	// the slot holds an older frame, so every field is overwritten; vectors keep their capacity
+	Frame& frame = frames.write_slot();
+	frame.map = std::make_shared<const Map>(map.fork());
+	frame.tile_size = tile_size;
+	frame.view = view;
+	frame.selected = selected;
+	frame.hovering = hovering;
+	frame.path_map = path_map;
+	frame.path = path;
+
+	frame.show_attack = false;
+	Unit selected_unit = map.get_unit(selected);
+	Unit target = map.get_unit(hovering);
+	if (ui_selected != -1 && selected_unit && target && target.side() != selected_unit.side()) {
+		Action action = ui.get_action(ui_selected);
+		if (action.type == Action::Type::Attack &&
+		    handler.get_probability(selected_unit, *action.weapon, target) != -1) {
+			frame.show_attack = true;
+			frame.attack_from = Vec2(selected_unit.pos()) + 0.5;
+			frame.attack_to = Vec2(target.pos()) + 0.5;
+		}
+	}
+
+	frame.ui_text.resize(ui.num_entries());
+	for (size_t i = 0; i < ui.num_entries(); i++) {
+		frame.ui_text[i] = ui.get_text(i);
+	}
+	frame.ui_hovering = ui_hovering;
+	frame.ui_selected = ui_selected;
+	frame.ui_version = ui_version;
+	frame.show_profile = show_profile;
+	frame.smooth_fog = smooth_fog;
+	movements.expire(seconds());
+	frame.movements = movements;  // fits in the slot's reserved capacity
+	frames.publish();
+}
+
+void SFMLRenderer::update_movements() {
+	if (!map.get_changes().has_changes(unit_changes)) return;
+	auto moves = std::make_shared<std::vector<MapChange>>();
+	map.get_changes().drain(unit_changes, [&](const MapChange& change) {
+		if (change.type == MapChange::Type::Reset) {
+			movements.clear();
+			moves->clear();
+		} else if (change.type == MapChange::Type::UnitRemoved) {
+			movements.stop(change.unit);
+		} else if (change.type == MapChange::Type::UnitMoved && movements.hold(change.unit, change.from)) {
+			moves->push_back(change);
+		}
+	});
+	if (moves->empty()) return;
+	dirty = true;
+
+	// units don't block paths, so the way each one went can be found again after the fact
+	auto snapshot = std::make_shared<Map>(map.fork());
+	auto paths = std::make_shared<std::vector<std::vector<Pos2>>>(moves->size());
+	move_jobs.submit([snapshot, moves, paths]() {
+		PathSettings settings;
+		settings.diag_cost = 1.4;
+		settings.step_cost = 2;
+		for (size_t i = 0; i < moves->size(); i++) {
+			Pos2 from = (*moves)[i].from;
+			Pos2 to = (*moves)[i].to;
+			// room for going round a wall or two; anything further just slides straight there
+			float radius = (float)std::max(std::abs(to.x - from.x), std::abs(to.y - from.y)) * 2 + 2;
+			PathMap path_map = Path::calc(*snapshot, from, radius, settings);
+			if (path_map.can_access(to)) {
+				(*paths)[i] = Path::to(path_map, to);
+			} else {
+				(*paths)[i] = { from, to };
+			}
+		}
+	}, [this, moves, paths]() {
+		double now = seconds();
+		for (size_t i = 0; i < moves->size(); i++) {
+			movements.start((*moves)[i].unit, (*paths)[i], now);
+		}
+	});
+}
+
+void SFMLRenderer::render_loop() {
+	window.setActive(true);
+	ui_texture.create(RIGHT_PANE_WIDTH, window.getSize().y);
+	load_atlas();
+
+	std::unique_lock<std::mutex> lock(wake_mutex);
+	while (true) {
+		// moving units are drawn every frame until they arrive, paced by the framerate limit; the
+		// overlay's numbers change without new frames too, so it's redrawn every so often
+		bool animating = frames.read_slot().movements.is_animating(seconds()) && !paused;
+		bool refresh = frames.read_slot().show_profile && !paused;
+		auto woken_or_stopping = [&]() { return woken || stopping; };
+		if (animating) {
+			// no waiting
+		} else if (refresh) {
+			wake.wait_for(lock, std::chrono::milliseconds(PROFILE_REFRESH_MS), woken_or_stopping);
+		} else {
+			wake.wait(lock, woken_or_stopping);
+		}
+		if (stopping) break;
+		woken = false;
 
+		lock.unlock();
+		if (frames.update() || animating || refresh) draw(frames.read_slot());
+		lock.lock();
+	}
+	window.setActive(false);
+}
+
+void SFMLRenderer::draw(const Frame& frame) {
+	if (!frame.map) return;
+	PROFILE("render.frame");
+	update_visible(frame);
+	update_chunks(frame.map);
 	window.clear();
-	draw_rect(Vec2(0, 0), map.get_size(), sf::Color(31, 31, 31));
-	render_movement();
-	render_cover();
-	render_units();
-	render_light();
-	render_fov();
-	render_ui();
+	render_floor(frame);
+	render_movement(frame);
+	render_cover(frame);
+	render_units(frame);  // also the path and attack line overlays
+	render_light(frame);
+	render_fov(frame);
+	render_ui(frame);
+	if (frame.show_profile) render_profile();
 	window.display();
 }
 
-void SFMLRenderer::render_cover() {
+void SFMLRenderer::render_cover(const Frame& frame) {
+	PROFILE("render.cover");
+	sf::RenderStates states(frame.view);
+	if (sf::VertexBuffer::isAvailable()) {
+		window.draw(wall_buffer, states);
+	} else {
+		window.draw(wall_vertices.data(), wall_vertices.size(), sf::PrimitiveType::Triangles, states);
+	}
+}
+
+void SFMLRenderer::update_chunks(const std::shared_ptr<const Map>& map) {
+	if (map == chunks_map) return;
+	const int chunk = CowGrid<Tile>::CHUNK_SIZE;
+	Pos2 size = map->get_size();
+	Pos2 num_chunks((size.x + chunk - 1) / chunk, (size.y + chunk - 1) / chunk);
+	if (!chunks_map || chunks_map->get_size() != size) {
+		build_walls(*map);
+		floor_chunks.clear();
+		floor_chunks.resize((size_t)num_chunks.x * num_chunks.y);
+		built_floor_chunks.clear();
+	} else {
+		// a tile that changed was written to, which unshared its chunk from older forks
+		const CowGrid<Tile>& tiles = map->get_tiles();
+		for (int cy = 0; cy < num_chunks.y; cy++) {
+			for (int cx = 0; cx < num_chunks.x; cx++) {
+				Pos2 from(cx * chunk, cy * chunk);
+				if (tiles.shares_chunk(chunks_map->get_tiles(), from)) continue;
+				floor_chunks[(size_t)cy * num_chunks.x + cx].built = false;
+				Pos2 to = (from + Pos2(chunk)).min(size);
+				for (int y = from.y; y < to.y; y++) {
+					for (int x = from.x; x < to.x; x++) {
+						patch_wall(*map, Pos2(x, y), Dir::North);
+						patch_wall(*map, Pos2(x, y), Dir::West);
+					}
+				}
+			}
+		}
+	}
+	chunks_map = map;
+
+	if (wall_buffer_stale && sf::VertexBuffer::isAvailable()) {
+		wall_buffer.create(wall_vertices.size());
+		wall_buffer.update(wall_vertices.data());
+		wall_buffer_stale = false;
+	}
+}
+
+void SFMLRenderer::build_walls(const Map& map) {
 	Pos2 size = map.get_size();
-	vertex_arr.clear();
-	sf::Color wall_color = sf::Color::White;
-	sf::Color cover_color(127, 127, 127);
+	wall_vertices.clear();
+	wall_slots.assign((size_t)size.x * size.y * 2, -1);
+	free_wall_slots.clear();
+	num_wall_slots = 0;
+	wall_buffer_stale = true;
 	for (int y = 0; y < size.y; y++) {
 		for (int x = 0; x < size.x; x++) {
-			const Tile& tile = map.get_tile(Pos2(x, y));
+			patch_wall(map, Pos2(x, y), Dir::North);
+			patch_wall(map, Pos2(x, y), Dir::West);
+		}
+	}
+}
 
-			if (tile.north_wall == Wall::Blocking) {
-				add_quad(Vec2(x, y) - 0.05, Vec2(1.1, 0.1), wall_color);
-			} else if (tile.north_wall == Wall::Cover) {
-				add_quad(Vec2(x, y) - 0.025, Vec2(1.05, 0.05), cover_color);
+void SFMLRenderer::patch_wall(const Map& map, Pos2 pos, Dir dir) {
+	const Tile& tile = map.get_tile(pos);
+	Wall wall = dir == Dir::North ? tile.north_wall : tile.west_wall;
+	int& slot = wall_slots[pos.idx(map.get_size().x) * 2 + (dir == Dir::North ? 0 : 1)];
+	if (wall == Wall::None && slot == -1) return;
+
+	if (slot == -1) {
+		if (free_wall_slots.empty()) {
+			slot = num_wall_slots++;
+			if (wall_vertices.size() < (size_t)num_wall_slots * 6) {
+				wall_vertices.resize(std::max<size_t>(wall_vertices.size() * 2, 6 * 64));
+				wall_buffer_stale = true;
 			}
+		} else {
+			slot = free_wall_slots.back();
+			free_wall_slots.pop_back();
+		}
+	}
+
+	sf::Vertex* v = &wall_vertices[slot * 6];
+	Vec2 corner(pos.x, pos.y);
+	if (wall == Wall::Blocking) {
+		set_quad(v, corner - 0.05, dir == Dir::North ? Vec2(1.1, 0.1) : Vec2(0.1, 1.1), sf::Color::White);
+	} else if (wall == Wall::Cover) {
+		set_quad(v, corner - 0.025, dir == Dir::North ? Vec2(1.05, 0.05) : Vec2(0.05, 1.05), sf::Color(127, 127, 127));
+	} else {
+		set_quad(v, Vec2(), Vec2(), sf::Color::Transparent);
+		free_wall_slots.push_back(slot);
+		slot = -1;
+	}
+	if (!wall_buffer_stale) wall_buffer.update(v, 6, (unsigned)(v - wall_vertices.data()));
+}
+
+void SFMLRenderer::render_floor(const Frame& frame) {
+	PROFILE("render.floor");
+	const Map& map = *frame.map;
+	sf::RenderStates states(frame.view);
+	if (frame.tile_size < MIN_TEXTURED_TILE) {
+		vertex_arr.clear();
+		add_quad(Vec2(visible_from), Vec2(visible_to - visible_from), FLOOR);
+		window.draw(vertex_arr, states);
+		return;
+	}
+	states.texture = &atlas;
+
+	if (!sf::VertexBuffer::isAvailable()) {
+		vertex_arr.clear();
+		for (int y = visible_from.y; y < visible_to.y; y++) {
+			for (int x = visible_from.x; x < visible_to.x; x++) {
+				size_t n = vertex_arr.getVertexCount();
+				vertex_arr.resize(n + 6);
+				set_tile(&vertex_arr[n], Pos2(x, y), map.get_tile(Pos2(x, y)).type);
+			}
+		}
+		window.draw(vertex_arr, states);
+		return;
+	}
+
+	const int chunk = CowGrid<Tile>::CHUNK_SIZE;
+	int chunks_x = (map.get_size().x + chunk - 1) / chunk;
+	Pos2 from_chunk = visible_from / chunk;
+	Pos2 to_chunk = (visible_to + Pos2(chunk - 1)) / chunk;
+	for (int cy = from_chunk.y; cy < to_chunk.y; cy++) {
+		for (int cx = from_chunk.x; cx < to_chunk.x; cx++) {
+			FloorChunk& floor_chunk = floor_chunks[(size_t)cy * chunks_x + cx];
+			if (!floor_chunk.built) build_floor_chunk(map, Pos2(cx, cy));
+			window.draw(floor_chunk.buffer, states);
+		}
+	}
+
+	if (built_floor_chunks.size() <= MAX_FLOOR_CHUNKS) return;
+	auto out_of_view = [&](size_t c) {
+		Pos2 pos((int)(c % chunks_x), (int)(c / chunks_x));
+		return pos.x < from_chunk.x || pos.y < from_chunk.y || pos.x >= to_chunk.x || pos.y >= to_chunk.y;
+	};
+	for (size_t c : built_floor_chunks) {
+		if (!out_of_view(c)) continue;
+		floor_chunks[c].buffer = sf::VertexBuffer();
+		floor_chunks[c].built = false;
+	}
+	built_floor_chunks.erase(std::remove_if(built_floor_chunks.begin(), built_floor_chunks.end(), out_of_view),
+	                         built_floor_chunks.end());
+}
+
+void SFMLRenderer::build_floor_chunk(const Map& map, Pos2 chunk) {
+	const int size = CowGrid<Tile>::CHUNK_SIZE;
+	Pos2 map_size = map.get_size();
+	FloorChunk& floor_chunk = floor_chunks[(size_t)chunk.y * ((map_size.x + size - 1) / size) + chunk.x];
+	Pos2 from = chunk * size;
+	Pos2 to = (from + Pos2(size)).min(map_size);
+	chunk_vertices.clear();
+	for (int y = from.y; y < to.y; y++) {
+		for (int x = from.x; x < to.x; x++) {
+			size_t n = chunk_vertices.size();
+			chunk_vertices.resize(n + 6);
+			set_tile(&chunk_vertices[n], Pos2(x, y), map.get_tile(Pos2(x, y)).type);
+		}
+	}
 
-			if (tile.west_wall == Wall::Blocking) {
-				add_quad(Vec2(x, y) - 0.05, Vec2(0.1, 1.1), wall_color);
-			} else if (tile.west_wall == Wall::Cover) {
-				add_quad(Vec2(x, y) - 0.025, Vec2(0.05, 1.05), cover_color);
+	if (floor_chunk.buffer.getVertexCount() == 0) {
+		floor_chunk.buffer.setPrimitiveType(sf::PrimitiveType::Triangles);
+		floor_chunk.buffer.setUsage(sf::VertexBuffer::Static);
+		floor_chunk.buffer.create(chunk_vertices.size());
+		built_floor_chunks.push_back((size_t)(&floor_chunk - floor_chunks.data()));
+	}
+	floor_chunk.buffer.update(chunk_vertices.data());
+	floor_chunk.built = true;
+}
+
+void SFMLRenderer::set_tile(sf::Vertex* v, Pos2 pos, int16_t type) const {
+	// untyped tiles are -1, so they get the first cell; unknown types fall back to it too
+	int cell = type + 1;
+	if (cell < 0 || cell >= atlas_cells) cell = 0;
+	set_quad(v, Vec2(pos), Vec2(1, 1), sf::Color::White);
+	// inset by half a texel so neighbouring cells never bleed in
+	float left = (float)(cell % atlas_columns * ATLAS_TILE) + 0.5f;
+	float top = (float)(cell / atlas_columns * ATLAS_TILE) + 0.5f;
+	float right = left + ATLAS_TILE - 1;
+	float bottom = top + ATLAS_TILE - 1;
+	v[0].texCoords = sf::Vector2f(left, top);
+	v[1].texCoords = sf::Vector2f(right, top);
+	v[2].texCoords = sf::Vector2f(left, bottom);
+	v[3].texCoords = sf::Vector2f(left, bottom);
+	v[4].texCoords = sf::Vector2f(right, top);
+	v[5].texCoords = sf::Vector2f(right, bottom);
+}
+
+void SFMLRenderer::load_atlas() {
+	sf::Image image;
+	if (!image.loadFromFile("resources/tiles.png")) {
+		// the floor colour for untyped tiles and a shade of it for each type, until there's art
+		std::cout << "Couldn't load tile atlas, using flat colours" << std::endl;
+		const unsigned num_cells = 8;
+		image.create(ATLAS_TILE * num_cells, ATLAS_TILE, FLOOR);
+		for (unsigned cell = 1; cell < num_cells; cell++) {
+			sf::Color color(FLOOR.r + 6 * cell, FLOOR.g + 4 * cell, FLOOR.b + 2 * (cell % 3));
+			for (unsigned y = 0; y < ATLAS_TILE; y++) {
+				for (unsigned x = 0; x < ATLAS_TILE; x++) {
+					image.setPixel(cell * ATLAS_TILE + x, y, color);
+				}
 			}
 		}
 	}
-	window.draw(vertex_arr);
+	if (!atlas.loadFromImage(image)) {
+		std::cout << "Couldn't create tile atlas texture" << std::endl;
+	}
+	atlas_columns = std::max(1, (int)image.getSize().x / ATLAS_TILE);
+	atlas_cells = atlas_columns * std::max(1, (int)image.getSize().y / ATLAS_TILE);
 }
 
-void SFMLRenderer::render_light() {
-	Pos2 size = map.get_size();
+void SFMLRenderer::render_light(const Frame& frame) {
+	PROFILE("render.light");
 	vertex_arr.clear();
 	sf::Color color(255, 255, 127, 31);
-	for (int y = 0; y < size.y; y++) {
-		for (int x = 0; x < size.x; x++) {
-			if (map.is_lit(Pos2(x, y))) {
+	for (int y = visible_from.y; y < visible_to.y; y++) {
+		for (int x = visible_from.x; x < visible_to.x; x++) {
+			if (frame.map->is_lit(Pos2(x, y))) {
 				add_quad(Pos2(x, y), color);
 			}
 		}
 	}
-	window.draw(vertex_arr);
-}
-
-void SFMLRenderer::render_units() {
-	auto& units = map.get_units();
-	for (auto& unit : units) {
-		sf::Color color = (unit.get() == selected) ? sf::Color(255, 127, 127) : sf::Color::Red;
-		float radius = (unit.get() == hovering) ? 0.35f : 0.3f;
-		draw_circle(Vec2(unit->pos()) + 0.5, radius, color);
-
-		if (unit.get() == hovering && ui_selected != -1) {
-			const Action& action = ui.get_action(ui_selected);
-			if (action.type != Action::Type::Attack) continue;
-			int probability;
-			auto iter = hit_probabilities.find(unit.get());
-			if (iter == hit_probabilities.end()) {
-				if (unit->side() == selected->side()) {
-					probability = -1;
-				} else {
-					probability = handler.get_probability(*selected, *action.weapon, *unit);
-				}
-				hit_probabilities[unit.get()] = probability;
-			} else {
-				probability = iter->second;
-			}
+	window.draw(vertex_arr, sf::RenderStates(frame.view));
+}
 
-			if (probability != -1) {
-				draw_line_rounded(Vec2(selected->pos()) + 0.5, Vec2(unit->pos()) + 0.5, 0.1, ORANGE);
-			}
+void SFMLRenderer::render_units(const Frame& frame) {
+	PROFILE("render.units");
+	const Map& map = *frame.map;
+	const Unit selected_unit = map.get_unit(frame.selected);
+	vertex_arr.clear();
+
+	if (selected_unit && selected_unit.side() == Side::You) {
+		for (int i = 0; i < (int)frame.path.size() - 1; i++) {
+			add_line_rounded(Vec2(frame.path[i]) + 0.5, Vec2(frame.path[i + 1]) + 0.5, 0.1, sf::Color::Yellow);
 		}
 	}
+
+	auto add_unit = [&](UnitHandle handle, Vec2 pos) {
+		sf::Color color = (handle == frame.selected) ? sf::Color(255, 127, 127) : sf::Color::Red;
+		float radius = (handle == frame.hovering) ? 0.35f : 0.3f;
+		add_circle(pos + 0.5, radius, color);
+	};
+
+	// moving units are drawn on their way and skipped where the map has already put them
+	num_draws++;
+	frame.movements.for_each(seconds(), [&](UnitHandle handle, Vec2 pos) {
+		if (handle.slot >= moving_draws.size()) moving_draws.resize(handle.slot + 1, 0);
+		moving_draws[handle.slot] = num_draws;
+		if (pos.x + 1 < visible_from.x || pos.y + 1 < visible_from.y || pos.x > visible_to.x || pos.y > visible_to.y) return;
+		add_unit(handle, pos);
+	});
+	for (Side side : { Side::You, Side::Enemy }) {
+		map.get_unit_index().for_each_in_rect(side, visible_from, visible_to, [&](UnitHandle handle, Pos2 pos) {
+			if (handle.slot < moving_draws.size() && moving_draws[handle.slot] == num_draws) return;
+			add_unit(handle, Vec2(pos));
+		});
+	}
+	if (frame.show_attack) {
+		add_line_rounded(frame.attack_from, frame.attack_to, 0.1, ORANGE);
+	}
+	window.draw(vertex_arr, sf::RenderStates(frame.view));
 }
 
-void SFMLRenderer::render_fov() {
-	Pos2 size = map.get_size();
-	vertex_arr.clear();
-	sf::Color color(0, 0, 0, 190);
-	size_t i;
-	for (int y = 0; y < size.y; y++) {
-		for (int x = 0; x < size.x; x++) {
-			bool can_see = false;
-			for (auto& unit : map.get_units()) {
-				if (unit->side() == Side::You && unit->can_see(Pos2(x, y))) {
-					can_see = true;
-					break;
-				}
-			}
+void SFMLRenderer::render_fov(const Frame& frame) {
+	PROFILE("render.fov");
+	update_fog(frame);
+	sf::Sprite fog(fog_texture);
+	window.draw(fog, sf::RenderStates(frame.view));
+}
 
-			if (!can_see) {
-				add_quad(Pos2(x, y), color);
+void SFMLRenderer::update_fog(const Frame& frame) {
+	const UnitStore& units = frame.map->get_units();
+	Pos2 size = frame.map->get_size();
+	bool resized = fog_texture.getSize().x != (unsigned)size.x || fog_texture.getSize().y != (unsigned)size.y;
+	if (resized) fog_texture.create((unsigned)size.x, (unsigned)size.y);
+	if (fog_texture.isSmooth() != frame.smooth_fog) fog_texture.setSmooth(frame.smooth_fog);
+	// only friendly FOVs clear the fog, so enemy moves don't rebuild it
+	if (!resized && units.get_fov_version(Side::You) == fog_version) return;
+	fog_version = units.get_fov_version(Side::You);
+
+	const sf::Uint8 fog_alpha = 190;
+	fog_pixels.assign((size_t)size.x * size.y * 4, 0);
+	for (size_t i = 3; i < fog_pixels.size(); i += 4) {
+		fog_pixels[i] = fog_alpha;
+	}
+	// clear the fog from what each friendly unit can see, which is far less than units * tiles
+	for (size_t i = 0; i < units.size(); i++) {
+		if (units.side(i) != Side::You) continue;
+		Pos2 from = units.fov_offset(i).max(Pos2());
+		Pos2 to = (units.fov_offset(i) + units.fov_size(i)).min(size);
+		for (int y = from.y; y < to.y; y++) {
+			for (int x = from.x; x < to.x; x++) {
+				if (units.can_see(i, Pos2(x, y))) fog_pixels[((size_t)y * size.x + x) * 4 + 3] = 0;
 			}
 		}
 	}
-	window.draw(vertex_arr);
+	fog_texture.update(fog_pixels.data());
 }
 
-void SFMLRenderer::render_movement() {
-	if (selected && selected->side() == Side::You) {
+void SFMLRenderer::render_movement(const Frame& frame) {
+	PROFILE("render.movement");
+	const Unit selected_unit = frame.map->get_unit(frame.selected);
+	if (selected_unit && selected_unit.side() == Side::You && frame.path_map) {
 		float max = 0;
 		float min = 99999;
 
-		Pos2 size = map.get_size();
-		sf::VertexArray arr(sf::PrimitiveType::Triangles);
 		vertex_arr.clear();
-		for (int y = 0; y < size.y; y++) {
-			for (int x = 0; x < size.x; x++) {
-				PathNode* path_node = path_map.get_node(Pos2(x, y));
+		for (int y = visible_from.y; y < visible_to.y; y++) {
+			for (int x = visible_from.x; x < visible_to.x; x++) {
+				const PathNode* path_node = frame.path_map->get_node(Pos2(x, y));
 				if (path_node == nullptr || path_node->state != PathNode::ACCESSABLE) continue;
-				add_quad(Pos2(x, y), get_segment_color(path_node->segment, selected->move_segments()));
+				add_quad(Pos2(x, y), get_segment_color(path_node->segment, selected_unit.move_segments()));
 				if (path_node->dist > max) max = path_node->dist;
 				if (path_node->dist < min) min = path_node->dist;
 			}
 		}
-		window.draw(vertex_arr);
-
-		for (int i = 0; i < (int)path.size() - 1; i++) {
-			draw_line_rounded(Vec2(path[i]) + 0.5, Vec2(path[i + 1]) + 0.5, 0.1, sf::Color::Yellow);
-		}
+		window.draw(vertex_arr, sf::RenderStates(frame.view));
 	}
 }
 
-void SFMLRenderer::render_ui() {
-	if (ui.has_changed()) {
+void SFMLRenderer::render_ui(const Frame& frame) {
+	PROFILE("render.ui");
+	if (frame.ui_version != drawn_ui_version) {
+		drawn_ui_version = frame.ui_version;
 		ui_texture.clear(sf::Color(31, 31, 31));
-		for (size_t i = 0; i < ui.num_entries(); i++) {
-			sf::Text text(ui.get_text(i), font, INFO_HEIGHT);
+		for (size_t i = 0; i < frame.ui_text.size(); i++) {
+			sf::Text text(frame.ui_text[i], font, INFO_HEIGHT);
 			text.setPosition(INFO_MARGIN, (float)(i * INFO_HEIGHT + INFO_MARGIN));
 			text.setFillColor(sf::Color(223, 223, 223));
-			if (i == ui_hovering || i == ui_selected) {
+			if ((int)i == frame.ui_hovering || (int)i == frame.ui_selected) {
 				auto bounds = text.getGlobalBounds();
 				sf::RectangleShape rect(sf::Vector2f(bounds.width + 10, INFO_HEIGHT));
 				rect.setPosition(bounds.left - 5, text.getPosition().y + 3);
-				rect.setFillColor(i == ui_selected ? AZURE : darken(AZURE));
+				rect.setFillColor((int)i == frame.ui_selected ? AZURE : darken(AZURE));
 				ui_texture.draw(rect);
 			}
 			ui_texture.draw(text);
@@ -217,68 +632,81 @@ void SFMLRenderer::render_ui() {
 	prev_frame = now;
 }
 
+void SFMLRenderer::render_profile() {
+	// one text per column, as the font isn't monospaced
+	const int num_columns = 5;
+	const float column_x[num_columns] = { 0, 150, 220, 290, 360 };
+	std::string columns[num_columns] = { "section\n", "calls\n", "min ms\n", "avg ms\n", "p99 ms\n" };
+	char value[32];
+	for (const Profiler::Sample& sample : Profiler::samples()) {
+		columns[0] += sample.name + "\n";
+		columns[1] += std::to_string(sample.calls) + "\n";
+		double times[] = { sample.min_ns / 1e6, sample.mean_ns() / 1e6, sample.p99_ns / 1e6 };
+		for (int i = 0; i < 3; i++) {
+			std::snprintf(value, sizeof(value), "%.2f\n", times[i]);
+			columns[i + 2] += value;
+		}
+	}
+
+	Vec2 pos(10, 10 + INFO_HEIGHT * 2);
+	float height = 0;
+	std::vector<sf::Text> texts;
+	for (int i = 0; i < num_columns; i++) {
+		texts.emplace_back(columns[i], font, INFO_HEIGHT * 3 / 4);
+		texts.back().setPosition((float)pos.x + column_x[i], (float)pos.y);
+		texts.back().setFillColor(sf::Color(223, 223, 223));
+		height = std::max(height, texts.back().getGlobalBounds().height);
+	}
+	sf::RectangleShape back(sf::Vector2f(column_x[num_columns - 1] + 90, height + 20));
+	back.setFillColor(sf::Color(0, 0, 0, 191));
+	back.setPosition((float)pos.x - 10, (float)pos.y - 10);
+	window.draw(back);
+	for (const sf::Text& text : texts) {
+		window.draw(text);
+	}
+}
+
 void SFMLRenderer::add_quad(Vec2 pos, sf::Color color) {
 	add_quad(pos, Vec2(1, 1), color);
 }
 
 void SFMLRenderer::add_quad(Vec2 pos, Vec2 size, sf::Color color) {
-	Vec2 top_left = (Vec2(pos.x, pos.y) + render_pos) * tile_size;
-	Vec2 bot_rite = (Vec2(pos.x + size.x, pos.y + size.y) + render_pos) * tile_size;
-	vertex_arr.append(sf::Vertex(sf::Vector2f(top_left.x, top_left.y), color));
-	vertex_arr.append(sf::Vertex(sf::Vector2f(bot_rite.x, top_left.y), color));
-	vertex_arr.append(sf::Vertex(sf::Vector2f(top_left.x, bot_rite.y), color));
-	vertex_arr.append(sf::Vertex(sf::Vector2f(top_left.x, bot_rite.y), color));
-	vertex_arr.append(sf::Vertex(sf::Vector2f(bot_rite.x, top_left.y), color));
-	vertex_arr.append(sf::Vertex(sf::Vector2f(bot_rite.x, bot_rite.y), color));
+	size_t n = vertex_arr.getVertexCount();
+	vertex_arr.resize(n + 6);
+	set_quad(&vertex_arr[n], pos, size, color);
 }
 
-void SFMLRenderer::reset_grid(const Grid<Tile>& g) {
-	gridPos = Vec2(0, 0);
-	update_render_pos();
+void SFMLRenderer::add_circle(Vec2 pos, float radius, sf::Color color) {
+	sf::Vector2f centre((float)pos.x, (float)pos.y);
+	for (size_t i = 0; i < CIRCLE_POINTS; i++) {
+		vertex_arr.append(sf::Vertex(centre, color));
+		vertex_arr.append(sf::Vertex(centre + circle_fan[i] * radius, color));
+		vertex_arr.append(sf::Vertex(centre + circle_fan[i + 1] * radius, color));
+	}
 }
 
-void SFMLRenderer::draw_line(Vec2 start, Vec2 end, float thickness, sf::Color color) {
-	start += render_pos;
-	end += render_pos;
-	float length = (float)(end - start).length();
-	float angle  = (float)((end - start).angle() * 360 / TAU);
-	sf::RectangleShape line(sf::Vector2f((thickness + length) * tile_size, thickness * tile_size));
-	line.setOrigin(thickness / 2 * tile_size, thickness / 2 * tile_size);
-	line.setPosition((float)start.x * tile_size, (float)start.y * tile_size);
-	line.setRotation(angle);
-	line.setFillColor(color);
-	window.draw(line);
-}
-void SFMLRenderer::draw_line_rounded(Vec2 start, Vec2 end, float thickness, sf::Color color) {
-	start += render_pos;
-	end += render_pos;
-	float length = (float)(end - start).length();
-	float angle  = (float)((end - start).angle() * 360 / TAU);
-	sf::RectangleShape line(sf::Vector2f(length * tile_size, thickness * tile_size));
-	line.setOrigin(0, thickness / 2 * tile_size);
-	line.setPosition((float)start.x * tile_size, (float)start.y * tile_size);
-	line.setRotation(angle);
-	line.setFillColor(color);
-	draw_circle(start - render_pos, thickness / 2, color);
-	draw_circle(end - render_pos, thickness / 2, color);
-	window.draw(line);
-}
-void SFMLRenderer::draw_circle(Vec2 pos, float radius, sf::Color color) {
-	radius *= tile_size;
-	pos += render_pos;
-	pos *= tile_size;
-	sf::CircleShape circle(radius);
-	circle.setOrigin(radius, radius);
-	circle.setPosition((float)pos.x, (float)pos.y);
-	circle.setFillColor(color);
-	window.draw(circle);
-}
-void SFMLRenderer::draw_rect(Vec2 pos, Vec2 size, sf::Color color) {
-	pos += render_pos;
-	sf::RectangleShape rect(sf::Vector2f((float)size.x, (float)size.y) * tile_size);
-	rect.setPosition(sf::Vector2f((float)pos.x, (float)pos.y) * tile_size);
-	rect.setFillColor(color);
-	window.draw(rect);
+void SFMLRenderer::add_line_rounded(Vec2 start, Vec2 end, float thickness, sf::Color color) {
+	Vec2 dir = end - start;
+	double length = dir.length();
+	if (length > 0) {
+		Vec2 side = Vec2(-dir.y, dir.x) * (thickness / 2 / length);
+		sf::Vector2f corners[4];
+		Vec2 points[4] = { start + side, end + side, start - side, end - side };
+		for (int i = 0; i < 4; i++) {
+			corners[i] = sf::Vector2f((float)points[i].x, (float)points[i].y);
+		}
+		for (int i : { 0, 1, 2, 2, 1, 3 }) {
+			vertex_arr.append(sf::Vertex(corners[i], color));
+		}
+	}
+	add_circle(start, thickness / 2, color);
+	add_circle(end, thickness / 2, color);
+}
+
+void SFMLRenderer::reset_grid(const CowGrid<Tile>& g) {
+	gridPos = Vec2(0, 0);
+	update_render_pos();
+	dirty = true;
 }
 
 void SFMLRenderer::pause() {
@@ -286,12 +714,18 @@ void SFMLRenderer::pause() {
 }
 void SFMLRenderer::unpause() {
 	paused = false;
+	dirty = true;
 }
 
 sf::RenderWindow& SFMLRenderer::get_window() {
 	return window;
 }
 
+void SFMLRenderer::set_smooth_fog(bool smooth) {
+	smooth_fog = smooth;
+	dirty = true;
+}
+
 void SFMLRenderer::mouse_move(Pos2 mouse_pos) {
 	if (dragging) {
 		Vec2 dist = Vec2(mouse_pos - prev_mouse_pos) / tile_size;
@@ -300,6 +734,7 @@ void SFMLRenderer::mouse_move(Pos2 mouse_pos) {
 		prev_mouse_pos = mouse_pos;
 		dragged = true;
 		update_render_pos();
+		dirty = true;
 	}
 	map_mouse_pos = Pos2(Vec2(mouse_pos) / tile_size - render_pos);
 
@@ -316,51 +751,64 @@ void SFMLRenderer::mouse_move(Pos2 mouse_pos) {
 	}
 
 	if (map.in_bounds(Vec2(map_mouse_pos.x, map_mouse_pos.y))) {
-		hovering = map.get_unit(map_mouse_pos);
+		UnitHandle new_hovering = map.get_unit(map_mouse_pos).handle();
+		if (new_hovering != hovering) dirty = true;
+		hovering = new_hovering;
 	}
 
-	if (selected) {
-		if (selected->side() == Side::You && hovering == nullptr && path_map.can_access(map_mouse_pos)) {
-			path = Path::to(path_map, map_mouse_pos);
-		} else {
-			path.clear();
+	Unit selected_unit = map.get_unit(selected);
+	if (selected_unit) {
+		std::vector<Pos2> new_path;
+		if (selected_unit.side() == Side::You && hovering.is_none() && path_map &&
+		    path_map->can_access(map_mouse_pos)) {
+			new_path = Path::to(*path_map, map_mouse_pos);
 		}
+		if (new_path != path) dirty = true;
+		path = std::move(new_path);
 	}
 }
 void SFMLRenderer::mouse_press(Pos2 mouse_pos, Mouse mouse) {
+	dirty = true;
 	if (mouse == Mouse::LEFT) {
 		dragging = true;
 		dragged = false;
 		prev_mouse_pos = mouse_pos;
-	} else if (mouse == Mouse::RIGHT && !dragging && selected != nullptr) {
-		PathNode* path_node = path_map.get_node(map_mouse_pos);
+	} else if (mouse == Mouse::RIGHT && !dragging && map.get_unit(selected)) {
+		Unit target = map.get_unit(hovering);
+		if (ui_selected != -1 && target) {
+			Action action = ui.get_action(ui_selected);
+			if (action.type != Action::Type::Attack || target.side() == map.get_unit(selected).side()) return;
+			handler.on_action(Action(map.get_unit(selected), *action.weapon, target));
+			return;
+		}
+
+		const PathNode* path_node = path_map ? path_map->get_node(map_mouse_pos) : nullptr;
 		if (path_node == nullptr || path_node->state != PathNode::ACCESSABLE) return;
-		handler.on_action(Action(*selected, map_mouse_pos, path_node->segment));
+		handler.on_action(Action(map.get_unit(selected), map_mouse_pos, path_node->segment));
 		prev_mouse_pos = mouse_pos;
-		selected = nullptr;
+		selected = UnitHandle();
 	}
 }
 void SFMLRenderer::mouse_release(Pos2, Mouse mouse) {
+	dirty = true;
 	if (mouse == Mouse::LEFT) {
 		if (!dragged) {
 			ui.set_has_changed();
 			ui_selected = -1;
 			if (ui_hovering != -1) {
 				ui_selected = ui_hovering;
-				hit_probabilities.clear();
-			} else if (selected == hovering || hovering == nullptr) {
-				selected = nullptr;
-				handler.on_select(nullptr);
+			} else if (selected == hovering || hovering.is_none()) {
+				selected = UnitHandle();
+				handler.on_select(UnitHandle());
 			} else {
 				selected = hovering;
 				handler.on_select(selected);
 
-				if (selected->side() == Side::You) {
-					PathSettings settings;
-					settings.diag_cost = 1.4;
-					settings.step_cost = 2;
-					path_map = Path::calc(map, selected->pos(), selected->move_radius(), settings, selected->move_segments());
-					path.clear();
+				Unit selected_unit = map.get_unit(selected);
+				path_map.reset();
+				path.clear();
+				if (selected_unit.side() == Side::You) {
+					request_path(selected_unit);
 				}
 			}
 		}
@@ -374,4 +822,38 @@ void SFMLRenderer::mouse_scroll(float amount) {
 		tile_size /= 2;
 	}
 	update_render_pos();
+	dirty = true;
+}
+
+void SFMLRenderer::resize(Pos2) {
+	dirty = true;
+}
+
+void SFMLRenderer::fkey_press(int num) {
+	if (num == 3) {
+		show_profile = !show_profile;
+		dirty = true;
+	} else if (num == 4) {
+		Profiler::save_csv("profile.csv");
+	} else if (num == 5) {
+		Profiler::reset();
+	}
+}
+
+void SFMLRenderer::request_path(const Unit& unit) {
+	PathSettings settings;
+	settings.diag_cost = 1.4;
+	settings.step_cost = 2;
+	auto snapshot = std::make_shared<Map>(map.fork());
+	auto result = std::make_shared<PathMap>();  // not written once published to the render thread
+	size_t request = ++path_request;
+	Pos2 pos = unit.pos();
+	float radius = unit.move_radius();
+	int num_segments = unit.move_segments();
+
+	path_jobs.submit([=]() mutable {
+		*result = Path::calc(*snapshot, pos, radius, settings, num_segments);
+	}, [this, result, request]() {
+		if (request == path_request) path_map = result;
+	});
 }
@@ -2,58 +2,182 @@
 #define SPENCE_SFMLRENDERER_H
 
 #include <unordered_map>
-#include <set>
 #include <memory>
 #include <SFML/Graphics.hpp>
 #include <deque>
 #include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "Renderer.h"
+#include "MovementPool.h"
 #include "map/Path.h"
 #include "IEventHandler.h"
 #include "UI.h"
+#include "util/JobQueue.h"
+#include "util/TripleBuffer.h"
 
+/// Draws on its own thread, which owns the window's GL context, while events and the game run on
+/// the thread that created it. That thread publishes snapshots of everything a frame shows, and
+/// the render thread draws the newest one, so neither ever waits for the other.
 class SFMLRenderer: public Renderer {
 public:
 	SFMLRenderer(Pos2 screen_size, float tile_size, Map& map, UI& ui, IEventHandler& handler);
+	~SFMLRenderer();
+	/// Publishes a frame for the render thread if needs_render(), otherwise does nothing.
 	void render() override;
-	void reset_grid(const Grid<Tile>& grid) override;
+	/// Whether anything drawn has changed since the last published frame: the camera, map, FOVs,
+	/// UI or what the mouse is over.
+	bool needs_render() const;
+	/// Stops the render thread and closes the window.
+	void close();
+	void reset_grid(const CowGrid<Tile>& grid) override;
 
 	void mouse_move(Pos2 pos) override;
 	void mouse_press(Pos2 pos, Mouse mouse) override;
 	void mouse_release(Pos2 pos, Mouse mouse) override;
 	void mouse_scroll(float amount) override;
+	void resize(Pos2 size) override;
+	/// F3 toggles the profiler overlay, F4 saves the profile to profile.csv, F5 resets it.
+	void fkey_press(int num) override;
 
 	void pause() override;
 	void unpause() override;
 
 	sf::RenderWindow& get_window();
+	/// Blends the fog between tiles instead of giving it hard edges.
+	void set_smooth_fog(bool smooth);
 
 private:
-	void render_movement();
-	void render_cover();
-	void render_light();
-	void render_units();
-	void render_fov();
-	void render_ui();
+	/// Everything a frame draws. The map is a fork, so taking it is O(1) and later moves don't
+	/// touch it; the path map is never written once a search publishes it.
+	struct Frame {
+		std::shared_ptr<const Map> map;
+		float tile_size = 1;
+		sf::Transform view;
+		UnitHandle selected;
+		UnitHandle hovering;
+		std::shared_ptr<const PathMap> path_map;
+		std::vector<Pos2> path;
+		bool show_attack = false;  // needs the event handler, so it's worked out when publishing
+		Vec2 attack_from;
+		Vec2 attack_to;
+		std::vector<std::string> ui_text;
+		int ui_hovering = -1;
+		int ui_selected = -1;
+		uint64_t ui_version = 0;
+		bool show_profile = false;
+		bool smooth_fog = false;
+		MovementPool movements;  // positioned by the render thread's clock
+	};
 
+	void publish();
+	void update_movements();
+	void render_loop();
+	void stop_render_thread();
+
+	// render thread
+	void draw(const Frame& frame);
+	void render_floor(const Frame& frame);
+	void render_movement(const Frame& frame);
+	void render_cover(const Frame& frame);
+	void render_light(const Frame& frame);
+	void render_units(const Frame& frame);
+	void render_fov(const Frame& frame);
+	void render_ui(const Frame& frame);
+	void render_profile();
+
+	void update_chunks(const std::shared_ptr<const Map>& map);
+	void build_walls(const Map& map);
+	void patch_wall(const Map& map, Pos2 pos, Dir dir);
+	void load_atlas();
+	void build_floor_chunk(const Map& map, Pos2 chunk);
+	void set_tile(sf::Vertex* v, Pos2 pos, int16_t type) const;
+	void update_fog(const Frame& frame);
+
+	// add_* append triangles in tile coordinates to vertex_arr, for drawing through the view
 	void add_quad(Vec2 pos, sf::Color color);
 	void add_quad(Vec2 pos, Vec2 size, sf::Color color);
+	void add_circle(Vec2 pos, float radius, sf::Color color);
+	void add_line_rounded(Vec2 start, Vec2 end, float thickness, sf::Color color);
 
-	void draw_line(Vec2 start, Vec2 end, float thickness, sf::Color color);
-	void draw_line_rounded(Vec2 start, Vec2 end, float thickness, sf::Color color);
-	void draw_circle(Vec2 pos, float radius, sf::Color color);
-	void draw_rect(Vec2 pos, Vec2 size, sf::Color color);
-	void draw_text(sf::Text text);
 	void update_render_pos();
+	void update_visible(const Frame& frame);
+	void request_path(const Unit& unit);
 
 	sf::Font font;
+	sf::RenderWindow window;
+
+	// Frames go through a triple buffer, so publishing and drawing never block each other. The
+	// mutex and condition variable only let the render thread sleep until there's a new one.
+	TripleBuffer<Frame> frames;
+	std::thread render_thread;
+	std::mutex wake_mutex;
+	std::condition_variable wake;
+	bool woken = false;
+	bool stopping = false;
+
+	// Everything below up to the input state belongs to the render thread.
 	sf::RenderTexture ui_texture;
+	uint64_t drawn_ui_version = 0;
+	Pos2 visible_from;  // tiles at least partly in the window, to exclusive
+	Pos2 visible_to;
+	std::vector<uint64_t> moving_draws;  // per unit slot, the last draw that animated it
+	uint64_t num_draws = 0;
+	sf::VertexArray vertex_arr;  // batch for the pass being drawn; keeps its capacity between frames
+	static const size_t CIRCLE_POINTS = 24;
+	sf::Vector2f circle_fan[CIRCLE_POINTS + 1];  // unit circle, first point repeated at the end
+
+	// Map the walls and floor were built from. Only the tiles in chunks the new frame's map no
+	// longer shares with it are patched.
+	std::shared_ptr<const Map> chunks_map;
+
+	// Walls in tile coordinates, six vertices per wall, drawn through the view transform. A removed
+	// wall leaves a degenerate slot for the next new wall.
+	std::vector<sf::Vertex> wall_vertices;
+	sf::VertexBuffer wall_buffer;
+	std::vector<int> wall_slots;  // per tile, north then west wall; -1 for none
+	std::vector<int> free_wall_slots;
+	int num_wall_slots = 0;
+	bool wall_buffer_stale = true;  // grown since the last upload
+
+	// Floor tiles textured from an atlas by Tile::type, in one static vertex buffer per CowGrid
+	// chunk. Buffers are only built for chunks in view and rebuilt when the chunk changes; ones out
+	// of view are released once too many are built.
+	struct FloorChunk {
+		sf::VertexBuffer buffer;
+		bool built = false;
+	};
+	sf::Texture atlas;
+	int atlas_columns = 1;
+	int atlas_cells = 1;
+	std::vector<FloorChunk> floor_chunks;
+	std::vector<size_t> built_floor_chunks;  // those holding a buffer, built or not
+	std::vector<sf::Vertex> chunk_vertices;  // scratch for building one chunk
+
+	// One texel per tile whose alpha is the fog over it, stretched over the map by the view
+	// transform. Only rebuilt and uploaded when the FOV version of the units changes.
+	sf::Texture fog_texture;
+	std::vector<sf::Uint8> fog_pixels;
+	uint64_t fog_version = 0;
 
-	bool paused = false;
-	sf::RenderWindow window;
+	double average_frame_diff = 1;
+	int num_frames = 0;
+	std::chrono::steady_clock::time_point prev_frame;
+	sf::Text fps_text;
+
+	// Input state, only touched by the thread that handles events.
+	std::atomic<bool> paused { false };
+	bool dirty = true;                 // camera or hover state changed; map changes are caught by its hash
+	uint64_t published_hash = 0;       // Map::get_hash() at the last published frame
+	uint64_t published_fov_version = 0;
+	uint64_t ui_version = 0;           // bumped whenever the UI reports a change
 	float tile_size;
 	Vec2 render_pos;
-	sf::VertexArray vertex_arr;
+	sf::Transform view;  // tile coordinates to window coordinates
+	bool smooth_fog = false;
+	bool show_profile = false;
 
 	UI& ui;
 	Map& map;
@@ -66,26 +190,22 @@ private:
 	bool dragged  = false;
 	Pos2 prev_mouse_pos;
 	Pos2 map_mouse_pos;
-	Unit* hovering = nullptr;
-	Unit* selected = nullptr;
-	PathMap path_map;
+	UnitHandle hovering;
+	UnitHandle selected;
+	std::shared_ptr<const PathMap> path_map;
 	std::vector<Pos2> path;
 
 	int ui_hovering = -1;
 	int ui_selected = -1;
-	std::unordered_map<Unit*, int> hit_probabilities;
 
-	struct Movement {
-		Vec3 start, end;
-		double time_passed;
-		std::unique_ptr<Movement> next;
-	};
-	std::set<Movement> movements;
+	// Moves are drained from the change log and held where they started until a path job finds
+	// the way they went, then animated along it.
+	ChangeLog::Subscriber unit_changes;
+	MovementPool movements;
 
-	double average_frame_diff = 1;
-	int num_frames = 0;
-	std::chrono::steady_clock::time_point prev_frame;
-	sf::Text fps_text;
+	JobQueue path_jobs;
+	size_t path_request = 0;  // only the latest request gets published
+	JobQueue move_jobs;       // paths of units that moved, kept apart so they don't hold up path_jobs
 };
 
 
@@ -0,0 +1,203 @@
+#include "SoftwareRenderer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+// same colours as SFMLRenderer
+static const SoftwareRenderer::Color FLOOR_COLOR { 31, 31, 31, 255 };
+static const SoftwareRenderer::Color WALL_COLOR  { 255, 255, 255, 255 };
+static const SoftwareRenderer::Color COVER_COLOR { 127, 127, 127, 255 };
+static const SoftwareRenderer::Color UNIT_COLOR  { 255, 0, 0, 255 };
+static const SoftwareRenderer::Color SELECTED_COLOR { 255, 127, 127, 255 };
+static const SoftwareRenderer::Color LIGHT_COLOR { 255, 255, 127, 31 };
+static const SoftwareRenderer::Color FOG_COLOR   { 0, 0, 0, 190 };
+static const SoftwareRenderer::Color SEGMENT_COLORS[] = {
+	{ 0, 0, 63, 255 }, { 0, 31, 63, 255 }, { 63, 31, 0, 255 }, { 31, 15, 0, 255 },
+};
+
+SoftwareRenderer::SoftwareRenderer(Pos2 screen_size, float tile_size, Map& map):
+	map(map), fixed_tile_size(tile_size), tile_size(tile_size) {
+	resize(screen_size);
+}
+
+void SoftwareRenderer::resize(Pos2 new_size) {
+	size = new_size;
+	pixels.assign((size_t)size.x * size.y * 4, 255);
+}
+
+void SoftwareRenderer::reset_grid(const CowGrid<Tile>&) {
+	selected = UnitHandle();
+	path_map = PathMap();
+	fog_version = 0;
+}
+
+void SoftwareRenderer::select(UnitHandle unit) {
+	selected = unit;
+	path_map = PathMap();
+	Unit selected_unit = map.get_unit(unit);
+	if (!selected_unit) return;
+
+	PathSettings settings;
+	settings.diag_cost = 1.4;
+	settings.step_cost = 2;
+	path_map = Path::calc(map, selected_unit.pos(), selected_unit.move_radius(), settings,
+	                      selected_unit.move_segments());
+}
+
+void SoftwareRenderer::render() {
+	PROFILE("render.frame");
+	update_view();
+	for (size_t i = 0; i < pixels.size(); i += 4) {
+		pixels[i] = pixels[i + 1] = pixels[i + 2] = 0;
+	}
+	fill_rect(Vec2(visible_from), Vec2(visible_to - visible_from), FLOOR_COLOR);
+	render_movement();
+	render_cover();
+	render_units();
+	render_light();
+	render_fov();
+	num_frames++;
+}
+
+void SoftwareRenderer::update_view() {
+	Vec2 map_size(map.get_size());
+	Vec2 screen(size);
+	if (fixed_tile_size > 0) {
+		tile_size = fixed_tile_size;
+	} else if (map_size.x > 0 && map_size.y > 0) {
+		tile_size = (float)std::min(screen.x / map_size.x, screen.y / map_size.y);
+	}
+	render_pos = -map_size / 2 + screen / tile_size / 2;
+
+	Vec2 from = -render_pos;
+	Vec2 to = screen / tile_size - render_pos;
+	visible_from = Pos2((int)std::floor(from.x), (int)std::floor(from.y)).max(Pos2()).min(map.get_size());
+	visible_to = Pos2((int)std::ceil(to.x), (int)std::ceil(to.y)).max(Pos2()).min(map.get_size());
+}
+
+void SoftwareRenderer::render_movement() {
+	PROFILE("render.movement");
+	Unit selected_unit = map.get_unit(selected);
+	if (!selected_unit || selected_unit.side() != Side::You) return;
+	for (int y = visible_from.y; y < visible_to.y; y++) {
+		for (int x = visible_from.x; x < visible_to.x; x++) {
+			PathNode* path_node = path_map.get_node(Pos2(x, y));
+			if (path_node == nullptr || path_node->state != PathNode::ACCESSABLE) continue;
+			fill_rect(Vec2(x, y), Vec2(1, 1), SEGMENT_COLORS[std::min(path_node->segment, 3)]);
+		}
+	}
+}
+
+void SoftwareRenderer::render_cover() {
+	PROFILE("render.cover");
+	for (int y = visible_from.y; y < visible_to.y; y++) {
+		for (int x = visible_from.x; x < visible_to.x; x++) {
+			const Tile& tile = map.get_tile(Pos2(x, y));
+
+			if (tile.north_wall == Wall::Blocking) {
+				fill_rect(Vec2(x, y) - 0.05, Vec2(1.1, 0.1), WALL_COLOR);
+			} else if (tile.north_wall == Wall::Cover) {
+				fill_rect(Vec2(x, y) - 0.025, Vec2(1.05, 0.05), COVER_COLOR);
+			}
+
+			if (tile.west_wall == Wall::Blocking) {
+				fill_rect(Vec2(x, y) - 0.05, Vec2(0.1, 1.1), WALL_COLOR);
+			} else if (tile.west_wall == Wall::Cover) {
+				fill_rect(Vec2(x, y) - 0.025, Vec2(0.05, 1.05), COVER_COLOR);
+			}
+		}
+	}
+}
+
+void SoftwareRenderer::render_units() {
+	PROFILE("render.units");
+	for (Side side : { Side::You, Side::Enemy }) {
+		map.get_unit_index().for_each_in_rect(side, visible_from, visible_to, [&](UnitHandle handle, Pos2 pos) {
+			fill_circle(Vec2(pos) + 0.5, 0.3f, handle == selected ? SELECTED_COLOR : UNIT_COLOR);
+		});
+	}
+}
+
+void SoftwareRenderer::render_light() {
+	PROFILE("render.light");
+	for (int y = visible_from.y; y < visible_to.y; y++) {
+		for (int x = visible_from.x; x < visible_to.x; x++) {
+			if (map.is_lit(Pos2(x, y))) fill_rect(Vec2(x, y), Vec2(1, 1), LIGHT_COLOR);
+		}
+	}
+}
+
+void SoftwareRenderer::render_fov() {
+	PROFILE("render.fov");
+	update_fog();
+	int width = map.get_size().x;
+	for (int y = visible_from.y; y < visible_to.y; y++) {
+		for (int x = visible_from.x; x < visible_to.x; x++) {
+			if (fog[(size_t)y * width + x]) fill_rect(Vec2(x, y), Vec2(1, 1), FOG_COLOR);
+		}
+	}
+}
+
+void SoftwareRenderer::update_fog() {
+	const UnitStore& units = map.get_units();
+	Pos2 map_size = map.get_size();
+	size_t num_tiles = (size_t)map_size.x * map_size.y;
+	if (fog.size() == num_tiles && units.get_fov_version(Side::You) == fog_version) return;
+	fog_version = units.get_fov_version(Side::You);
+
+	fog.assign(num_tiles, 1);
+	for (size_t i = 0; i < units.size(); i++) {
+		if (units.side(i) != Side::You) continue;
+		Pos2 from = units.fov_offset(i).max(Pos2());
+		Pos2 to = (units.fov_offset(i) + units.fov_size(i)).min(map_size);
+		for (int y = from.y; y < to.y; y++) {
+			for (int x = from.x; x < to.x; x++) {
+				if (units.can_see(i, Pos2(x, y))) fog[(size_t)y * map_size.x + x] = 0;
+			}
+		}
+	}
+}
+
+void SoftwareRenderer::fill_rect(Vec2 pos, Vec2 rect_size, Color color) {
+	// pixels whose centres are inside, as a GPU would fill them
+	Vec2 from = (pos + render_pos) * tile_size;
+	Vec2 to = (pos + rect_size + render_pos) * tile_size;
+	int x0 = std::max(0, (int)std::ceil(from.x - 0.5)), x1 = std::min(size.x, (int)std::ceil(to.x - 0.5));
+	int y0 = std::max(0, (int)std::ceil(from.y - 0.5)), y1 = std::min(size.y, (int)std::ceil(to.y - 0.5));
+	for (int y = y0; y < y1; y++) {
+		for (int x = x0; x < x1; x++) {
+			blend((size_t)y * size.x + x, color);
+		}
+	}
+}
+
+void SoftwareRenderer::fill_circle(Vec2 pos, float radius, Color color) {
+	Vec2 centre = (pos + render_pos) * tile_size;
+	double r = radius * tile_size;
+	int x0 = std::max(0, (int)std::floor(centre.x - r)), x1 = std::min(size.x, (int)std::ceil(centre.x + r));
+	int y0 = std::max(0, (int)std::floor(centre.y - r)), y1 = std::min(size.y, (int)std::ceil(centre.y + r));
+	for (int y = y0; y < y1; y++) {
+		for (int x = x0; x < x1; x++) {
+			double dx = x + 0.5 - centre.x, dy = y + 0.5 - centre.y;
+			if (dx * dx + dy * dy <= r * r) blend((size_t)y * size.x + x, color);
+		}
+	}
+}
+
+bool SoftwareRenderer::save_ppm(const std::string& path) const {
+	std::ofstream file(path, std::ios::binary);
+	file << "P6\n" << size.x << " " << size.y << "\n255\n";
+	std::vector<char> rgb((size_t)size.x * size.y * 3);
+	for (size_t i = 0, j = 0; i < pixels.size(); i += 4, j += 3) {
+		rgb[j] = (char)pixels[i];
+		rgb[j + 1] = (char)pixels[i + 1];
+		rgb[j + 2] = (char)pixels[i + 2];
+	}
+	if (!file.write(rgb.data(), rgb.size())) {
+		std::cout << "Couldn't write frame " << path << std::endl;
+		return false;
+	}
+	return true;
+}
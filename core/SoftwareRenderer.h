@@ -0,0 +1,78 @@
+#ifndef SPENCE_SOFTWARERENDERER_H
+#define SPENCE_SOFTWARERENDERER_H
+
+#include <string>
+#include <vector>
+#include "Renderer.h"
+#include "map/Map.h"
+#include "map/Path.h"
+
+/// Rasterises the same passes as SFMLRenderer (floor, movement range, walls, units, light and fog)
+/// into an RGBA buffer in memory, with no window or GPU. Output only depends on the map, so frames
+/// can be compared against golden images, and each pass is profiled like the SFML ones.
+class SoftwareRenderer: public Renderer {
+public:
+	struct Color {
+		uint8_t r, g, b, a;
+	};
+
+	/// A tile_size of 0 fits the whole map on screen, recomputed every frame.
+	SoftwareRenderer(Pos2 screen_size, float tile_size, Map& map);
+	void render() override;
+	void reset_grid(const CowGrid<Tile>& grid) override;
+	void resize(Pos2 size) override;
+
+	/// Shows the unit's movement range, as if it had been clicked on. UnitHandle() for none.
+	void select(UnitHandle unit);
+
+	inline Pos2 get_size() const {
+		return size;
+	}
+	/// Last frame, four bytes per pixel, rows top to bottom.
+	inline const std::vector<uint8_t>& get_pixels() const {
+		return pixels;
+	}
+	inline size_t get_num_frames() const {
+		return num_frames;
+	}
+
+	/// Writes the last frame as a binary PPM. Returns false if the file couldn't be written.
+	bool save_ppm(const std::string& path) const;
+
+private:
+	void render_movement();
+	void render_cover();
+	void render_units();
+	void render_light();
+	void render_fov();
+
+	void update_view();
+	void update_fog();
+	void fill_rect(Vec2 pos, Vec2 rect_size, Color color);
+	void fill_circle(Vec2 pos, float radius, Color color);
+	inline void blend(size_t pixel, Color color) {
+		uint8_t* p = &pixels[pixel * 4];
+		p[0] = (uint8_t)((color.r * color.a + p[0] * (255 - color.a) + 127) / 255);
+		p[1] = (uint8_t)((color.g * color.a + p[1] * (255 - color.a) + 127) / 255);
+		p[2] = (uint8_t)((color.b * color.a + p[2] * (255 - color.a) + 127) / 255);
+	}
+
+	Map& map;
+	Pos2 size;
+	float fixed_tile_size;
+	float tile_size;
+	Vec2 render_pos;
+	Pos2 visible_from;  // tiles at least partly on screen, to exclusive
+	Pos2 visible_to;
+	std::vector<uint8_t> pixels;
+	size_t num_frames = 0;
+
+	UnitHandle selected;
+	PathMap path_map;
+
+	std::vector<uint8_t> fog;  // per tile, 1 where no friendly unit can see
+	uint64_t fog_version = 0;
+};
+
+
+#endif //SPENCE_SOFTWARERENDERER_H
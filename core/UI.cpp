@@ -42,6 +42,10 @@ bool UI::has_changed() {
 	return temp;
 }
 
+bool UI::is_changed() const {
+	return changed;
+}
+
 void UI::set_has_changed() {
 	changed = true;
 }
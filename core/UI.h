@@ -19,7 +19,10 @@ public:
 	Action get_action(size_t index);
 
 	void set_has_changed();
+	/// Whether anything changed since the last call, clearing the flag.
 	bool has_changed();
+	/// Same without clearing it.
+	bool is_changed() const;
 
 private:
 	struct Entry {
@@ -1,107 +1,108 @@
 #ifndef SPENCE_UNIT_H
 #define SPENCE_UNIT_H
 
-#include "Vec.h"
-#include "Weapon.h"
-#include "Grid.h"
-#include <set>
-#include <unordered_map>
-
-enum class Side { None, You, Enemy };
-
-struct UnitType {
-	UnitType(std::string name, int mov, int aim, int hp):
-		name(std::move(name)), mov(mov), aim(aim), hp(hp) { }
-	std::string name;
-	int mov;
-	int aim;
-	int hp;
-};
+#include "UnitStore.h"
 
+/// Lightweight view of one unit in a UnitStore. Cheap to copy; evaluates to false once the
+/// unit no longer exists.
 class Unit {
 public:
-	Unit(const UnitType& type, Side side, Pos2 pos): _type(type), _side(side), _pos(pos), _hp(type.hp), fov(Pos2()) { }
+	Unit() = default;
+	Unit(UnitStore& store, UnitHandle handle): store(&store), _handle(handle) { }
+
+	inline explicit operator bool() const {
+		return store != nullptr && store->valid(_handle);
+	}
+
+	inline UnitHandle handle() const {
+		return _handle;
+	}
 
 	inline const UnitType& type() const {
-		return _type;
+		return store->type(idx());
 	}
 
 	inline Side side() const {
-		return _side;
+		return store->side(idx());
 	}
 
 	inline Pos2 pos() const {
-		return _pos;
+		return store->pos(idx());
 	}
 	inline void set_pos(Pos2 pos) {
-		_pos = pos;
+		store->set_pos(idx(), pos);
 	}
 
 	inline float move_radius() const {
-		return _move_radius;
+		return store->move_radius(idx());
 	}
 	inline int move_segments() const {
-		return _move_segments;
+		return store->move_segments(idx());
 	}
 
 	inline int stamina() const {
-		return _stamina;
+		return store->stamina(idx());
 	}
 	inline void use_stamina(int amount) {
-		_stamina -= amount;
+		store->use_stamina(idx(), amount);
 	}
 
 	inline int hp() const {
-		return _hp;
+		return store->hp(idx());
+	}
+	inline void damage(int amount) {
+		store->damage(idx(), amount);
 	}
 
 	inline int ap() const {
-		return _ap;
+		return store->ap(idx());
 	}
 	inline void modify_ap(int amount) {
-		set_ap(_ap + amount);
+		set_ap(ap() + amount);
 	}
 	inline void set_ap(int amount) {
-		_ap = amount;
-		update_move();
+		store->set_ap(idx(), amount);
+	}
+	inline void spend_move(int segment) {
+		store->spend_move(idx(), segment);
 	}
 
 	inline void add_weapon(Weapon& weapon) {
-		_weapons.push_back(&weapon);
+		store->add_weapon(idx(), weapon);
 	}
-	inline const std::vector<Weapon*> get_weapons() const {
-		return _weapons;
+	inline WeaponList get_weapons() const {
+		return store->get_weapons(idx());
 	}
 
-	inline void set_fov(Grid<char> fov_grid) {
-		fov = std::move(fov_grid);
+	inline void set_fov(const Grid<char>& fov_grid) {
+		store->set_fov(idx(), fov_grid);
 	}
 	inline bool can_see(Pos2 pos) const {
-		return fov.get(pos);
+		return store->can_see(idx(), pos);
 	}
 
 private:
-	inline void update_move() {
-		_move_segments = _ap + (_stamina > 0 ? 1 : 0);
-		_move_radius = (float)_type.mov * ((float)_move_segments / 2.f);
+	inline size_t idx() const {
+		return store->index(_handle);
 	}
 
-	const UnitType& _type;
-	Side _side = Side::None;
-
-	std::vector<Weapon*> _weapons;
-
-	float _move_radius = 0;
-	int _move_segments = 0;
-
-	Pos2 _pos;
-
-	int _hp = 0;
-	int _ap = 0;
-	int _stamina = 3;
-
-	Grid<char> fov;
+	UnitStore* store = nullptr;
+	UnitHandle _handle;
 };
 
+inline bool operator==(const Unit& lhs, const Unit& rhs) {
+	return lhs.handle() == rhs.handle();
+}
+inline bool operator!=(const Unit& lhs, const Unit& rhs) {
+	return !(lhs == rhs);
+}
+
+inline Unit UnitStore::get(UnitHandle handle) {
+	return valid(handle) ? Unit(*this, handle) : Unit();
+}
+inline Unit UnitStore::unit(size_t i) {
+	return Unit(*this, handles[i]);
+}
+
 
 #endif //SPENCE_UNIT_H
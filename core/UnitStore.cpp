@@ -0,0 +1,139 @@
+#include "UnitStore.h"
+#include <algorithm>
+#include <atomic>
+
+static std::atomic<uint64_t> next_fov_version(1);
+
+UnitHandle UnitStore::create(const UnitType& type, Side side, Pos2 pos) {
+	uint32_t slot;
+	if (free_slots.empty()) {
+		slot = (uint32_t)slot_indices.size();
+		slot_indices.push_back(0);
+		slot_generations.push_back(0);
+	} else {
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+	slot_indices.set(slot, (uint32_t)handles.size());
+
+	UnitHandle handle(slot, slot_generations[slot]);
+	handles.push_back(handle);
+	types.push_back(&type);
+	sides.push_back(side);
+	positions.push_back(pos);
+	hps.push_back(type.hp);
+	aps.push_back(0);
+	staminas.push_back(3);
+	move_radii.push_back(0);
+	move_segment_counts.push_back(0);
+	weapons.resize(weapons.size() + MAX_WEAPONS, nullptr);
+	weapon_counts.push_back(0);
+	fov_offsets.push_back(Pos2());
+	fov_sizes.push_back(Pos2());
+	fov_cells.resize(fov_cells.size() + fov_stride, 0);
+	hash ^= unit_key(handles.size() - 1);
+	bump_fov_version(side);
+	return handle;
+}
+
+void UnitStore::destroy(UnitHandle handle) {
+	size_t i = index(handle);
+	size_t last = size() - 1;
+	Side side = sides[i];
+	hash ^= unit_key(i);
+	if (i != last) {
+		handles.set(i, handles[last]);
+		types.set(i, types[last]);
+		sides.set(i, sides[last]);
+		positions.set(i, positions[last]);
+		hps.set(i, hps[last]);
+		aps.set(i, aps[last]);
+		staminas.set(i, staminas[last]);
+		move_radii.set(i, move_radii[last]);
+		move_segment_counts.set(i, move_segment_counts[last]);
+		weapon_counts.set(i, weapon_counts[last]);
+		fov_offsets.set(i, fov_offsets[last]);
+		fov_sizes.set(i, fov_sizes[last]);
+		for (size_t j = 0; j < MAX_WEAPONS; j++) {
+			weapons.set(i * MAX_WEAPONS + j, weapons[last * MAX_WEAPONS + j]);
+		}
+		for (size_t j = 0; j < fov_stride; j++) {
+			fov_cells.set(i * fov_stride + j, fov_cells[last * fov_stride + j]);
+		}
+		slot_indices.set(handles[i].slot, (uint32_t)i);
+	}
+
+	handles.pop_back();
+	types.pop_back();
+	sides.pop_back();
+	positions.pop_back();
+	hps.pop_back();
+	aps.pop_back();
+	staminas.pop_back();
+	move_radii.pop_back();
+	move_segment_counts.pop_back();
+	weapon_counts.pop_back();
+	fov_offsets.pop_back();
+	fov_sizes.pop_back();
+	weapons.resize(last * MAX_WEAPONS);
+	fov_cells.resize(last * fov_stride);
+
+	slot_generations.mut(handle.slot)++;
+	free_slots.push_back(handle.slot);
+	bump_fov_version(side);
+}
+
+void UnitStore::clear() {
+	while (size() > 0) {
+		destroy(handles[size() - 1]);
+	}
+}
+
+void UnitStore::add_weapon(size_t i, Weapon& weapon) {
+	assert(weapon_counts[i] < MAX_WEAPONS);
+	weapons.set(i * MAX_WEAPONS + weapon_counts[i], &weapon);
+	weapon_counts.mut(i)++;
+}
+
+void UnitStore::set_fov(size_t i, const Grid<char>& fov_grid) {
+	Pos2 size = fov_grid.get_size();
+	size_t num_cells = (size_t)size.x * (size_t)size.y;
+	if (num_cells > fov_stride) grow_fov_stride(num_cells);
+
+	bump_fov_version(sides[i]);
+	fov_offsets.set(i, fov_grid.get_offset());
+	fov_sizes.set(i, size);
+	const char* cells = fov_grid.data();
+	for (size_t j = 0; j < num_cells; j++) {
+		if (fov_cells[i * fov_stride + j] != cells[j]) fov_cells.set(i * fov_stride + j, cells[j]);
+	}
+}
+
+void UnitStore::grow_fov_stride(size_t stride) {
+	CowArray<char, 4096> cells(size() * stride, 0);
+	for (size_t i = 0; i < size(); i++) {
+		for (size_t j = 0; j < fov_stride; j++) {
+			cells.set(i * stride + j, fov_cells[i * fov_stride + j]);
+		}
+	}
+	fov_cells = std::move(cells);
+	fov_stride = stride;
+}
+
+uint64_t UnitStore::compute_hash() const {
+	uint64_t result = 0;
+	for (size_t i = 0; i < size(); i++) {
+		result ^= unit_key(i);
+	}
+	return result;
+}
+
+void UnitStore::bump_fov_version(Side side) {
+	fov_version = next_fov_version++;
+	side_fov_versions[(int)side] = fov_version;
+}
+
+void UnitStore::update_move(size_t i) {
+	move_segment_counts.set(i, aps[i] + (staminas[i] > 0 ? 1 : 0));
+	move_radii.set(i, (float)types[i]->mov * ((float)move_segment_counts[i] / 2.f));
+}
@@ -0,0 +1,199 @@
+#ifndef SPENCE_UNITSTORE_H
+#define SPENCE_UNITSTORE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Vec.h"
+#include "Weapon.h"
+#include "Grid.h"
+#include "util/CowArray.h"
+#include "util/Zobrist.h"
+
+enum class Side { None, You, Enemy };
+
+struct UnitType {
+	UnitType(std::string name, int mov, int aim, int hp):
+		name(std::move(name)), mov(mov), aim(aim), hp(hp) { }
+	inline int accuracy() const {
+		return 80 + aim * 2;
+	}
+	std::string name;
+	int mov;
+	int aim;
+	int hp;
+};
+
+/// Stable reference to a unit; stays invalid once the unit is destroyed, even if its slot is reused.
+struct UnitHandle {
+	static const uint32_t NONE = 0xffffffff;
+	UnitHandle() = default;
+	UnitHandle(uint32_t slot, uint32_t generation): slot(slot), generation(generation) { }
+	inline bool is_none() const {
+		return slot == NONE;
+	}
+	uint32_t slot = NONE;
+	uint32_t generation = 0;
+};
+inline bool operator==(UnitHandle lhs, UnitHandle rhs) {
+	return lhs.slot == rhs.slot && lhs.generation == rhs.generation;
+}
+inline bool operator!=(UnitHandle lhs, UnitHandle rhs) {
+	return !(lhs == rhs);
+}
+
+struct WeaponList {
+	Weapon* const* first;
+	size_t count;
+	Weapon* const* begin() const { return first; }
+	Weapon* const* end()   const { return first + count; }
+	size_t size() const { return count; }
+	Weapon* operator[](size_t i) const { return first[i]; }
+};
+
+class Unit;
+
+/// Pooled structure-of-arrays unit storage. Live units are packed into dense arrays indexed
+/// 0..size(); handles map to dense indices through a slot table. The arrays are copy-on-write,
+/// so copying a store is O(1).
+class UnitStore {
+public:
+	static const size_t MAX_WEAPONS = 4;
+
+	UnitHandle create(const UnitType& type, Side side, Pos2 pos);
+	void destroy(UnitHandle handle);
+	void clear();
+
+	inline size_t size() const {
+		return handles.size();
+	}
+	/// Zobrist hash of every live unit's type, side, position, hp, AP and stamina. Kept up to date
+	/// by each mutation. Units are keyed by the tile they stand on rather than their handle, so the
+	/// same units in the same places hash the same whatever order they were created in.
+	inline uint64_t get_hash() const {
+		return hash;
+	}
+	/// get_hash() recomputed from scratch, for checking the incremental updates.
+	uint64_t compute_hash() const;
+	inline bool valid(UnitHandle handle) const {
+		return handle.slot < slot_generations.size() && slot_generations[handle.slot] == handle.generation;
+	}
+	inline size_t index(UnitHandle handle) const {
+		assert(valid(handle));
+		return slot_indices[handle.slot];
+	}
+
+	Unit get(UnitHandle handle);
+	Unit unit(size_t i);
+
+	inline UnitHandle handle(size_t i)      const { return handles[i]; }
+	inline const UnitType& type(size_t i)   const { return *types[i]; }
+	inline Side side(size_t i)              const { return sides[i]; }
+	inline Pos2 pos(size_t i)               const { return positions[i]; }
+	inline int hp(size_t i)                 const { return hps[i]; }
+	inline int ap(size_t i)                 const { return aps[i]; }
+	inline int stamina(size_t i)            const { return staminas[i]; }
+	inline float move_radius(size_t i)      const { return move_radii[i]; }
+	inline int move_segments(size_t i)      const { return move_segment_counts[i]; }
+
+	inline void set_pos(size_t i, Pos2 pos) {
+		hash ^= unit_key(i);
+		positions.set(i, pos);
+		hash ^= unit_key(i);
+	}
+	inline void use_stamina(size_t i, int amount) {
+		hash ^= unit_key(i);
+		staminas.mut(i) -= amount;
+		hash ^= unit_key(i);
+	}
+	/// Pays for a move ending in the given path segment, drawing on stamina when short of AP.
+	inline void spend_move(size_t i, int segment) {
+		int move_cost = segment + 1;
+		if (move_cost > aps[i]) {
+			use_stamina(i, 1);
+			move_cost--;
+		}
+		set_ap(i, aps[i] - move_cost);
+	}
+	inline void damage(size_t i, int amount) {
+		hash ^= unit_key(i);
+		hps.mut(i) -= amount;
+		hash ^= unit_key(i);
+	}
+	inline void set_ap(size_t i, int amount) {
+		hash ^= unit_key(i);
+		aps.set(i, amount);
+		hash ^= unit_key(i);
+		update_move(i);
+	}
+
+	inline WeaponList get_weapons(size_t i) const {
+		return WeaponList { weapons.contiguous(i * MAX_WEAPONS), weapon_counts[i] };
+	}
+	void add_weapon(size_t i, Weapon& weapon);
+
+	void set_fov(size_t i, const Grid<char>& fov_grid);
+	inline Pos2 fov_offset(size_t i) const { return fov_offsets[i]; }
+	inline Pos2 fov_size(size_t i)   const { return fov_sizes[i]; }
+	/// Changes whenever any unit's FOV is set or a unit comes or goes, and is never reused, so
+	/// anything built from the FOVs can tell when it needs rebuilding.
+	inline uint64_t get_fov_version() const {
+		return fov_version;
+	}
+	/// As get_fov_version(), but only for the FOVs and units of one side.
+	inline uint64_t get_fov_version(Side side) const {
+		return side_fov_versions[(int)side];
+	}
+	inline bool can_see(size_t i, Pos2 pos) const {
+		Pos2 rel = pos - fov_offsets[i];
+		Pos2 size = fov_sizes[i];
+		if (rel.x < 0 || rel.y < 0 || rel.x >= size.x || rel.y >= size.y) return false;
+		return fov_cells[i * fov_stride + rel.idx(size.x)] != 0;
+	}
+
+private:
+	/// Key of a unit's whole hashed state, placed at its tile. The type goes in by its stats, not
+	/// its address, so every process agrees on the key.
+	inline uint64_t unit_key(size_t i) const {
+		const UnitType& t = *types[i];
+		uint64_t state = (uint64_t)(uint8_t)sides[i] | (uint64_t)(uint16_t)hps[i] << 8 |
+		                 (uint64_t)(uint8_t)aps[i] << 24 | (uint64_t)(uint8_t)staminas[i] << 32 |
+		                 (uint64_t)(uint8_t)t.mov << 40 | (uint64_t)(uint8_t)t.aim << 48 |
+		                 (uint64_t)(uint8_t)t.hp << 56;
+		return Zobrist::key(Zobrist::Feature::Unit, Zobrist::pack(positions[i]), state);
+	}
+	void update_move(size_t i);
+	void bump_fov_version(Side side);
+	void grow_fov_stride(size_t stride);
+
+	// dense, one entry per live unit
+	CowArray<UnitHandle> handles;
+	CowArray<const UnitType*> types;
+	CowArray<Side> sides;
+	CowArray<Pos2> positions;
+	CowArray<int> hps;
+	CowArray<int> aps;
+	CowArray<int> staminas;
+	CowArray<float> move_radii;
+	CowArray<int> move_segment_counts;
+	CowArray<Weapon*> weapons; // MAX_WEAPONS per unit, never straddling a chunk
+	CowArray<size_t> weapon_counts;
+
+	// fov grids live in one arena with a fixed stride per unit
+	CowArray<Pos2> fov_offsets;
+	CowArray<Pos2> fov_sizes;
+	CowArray<char, 4096> fov_cells;
+	size_t fov_stride = 0;
+	uint64_t fov_version = 0;
+	uint64_t side_fov_versions[3] = { };
+
+	// sparse, one entry per slot ever handed out
+	CowArray<uint32_t> slot_indices;
+	CowArray<uint32_t> slot_generations;
+	std::vector<uint32_t> free_slots;
+
+	uint64_t hash = 0;
+};
+
+
+#endif //SPENCE_UNITSTORE_H
@@ -0,0 +1,151 @@
+#include "ActionLog.h"
+#include <fstream>
+#include <iostream>
+
+static const char MAGIC[4] = { 'S', 'P', 'N', 'L' };
+static const uint8_t VERSION = 1;
+
+static void write_varint(std::string& out, uint64_t value) {
+	while (value >= 0x80) {
+		out.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((char)value);
+}
+
+static void write_zigzag(std::string& out, int64_t value) {
+	write_varint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void write_fixed(std::string& out, uint64_t value) {
+	for (int i = 0; i < 8; i++) {
+		out.push_back((char)(value >> (i * 8)));
+	}
+}
+
+struct Reader {
+	const std::string& data;
+	size_t at = 0;
+	bool ok = true;
+
+	uint8_t byte() {
+		if (at >= data.size()) {
+			ok = false;
+			return 0;
+		}
+		return (uint8_t)data[at++];
+	}
+	uint64_t varint() {
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			uint8_t b = byte();
+			value |= (uint64_t)(b & 0x7f) << shift;
+			if (!(b & 0x80)) break;
+		}
+		return value;
+	}
+	int64_t zigzag() {
+		uint64_t value = varint();
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+	uint64_t fixed() {
+		uint64_t value = 0;
+		for (int i = 0; i < 8; i++) {
+			value |= (uint64_t)byte() << (i * 8);
+		}
+		return value;
+	}
+};
+
+void ActionLog::add(const Action& action, size_t weapon, uint64_t hash) {
+	records.push_back(Record { action.type, action.unit, action.pos, action.segment, (uint8_t)weapon, hash });
+}
+
+Action ActionLog::get_action(size_t i, const Map& map) const {
+	const Record& record = records[i];
+	Action action(record.type);
+	action.unit = record.unit;
+	action.pos = record.pos;
+	action.segment = record.segment;
+	if (record.type == Action::Type::Attack) {
+		const Unit unit = map.get_unit(record.unit);
+		if (unit && record.weapon < unit.get_weapons().size()) {
+			action.weapon = unit.get_weapons()[record.weapon];
+		} else {
+			action.type = Action::Type::None;
+		}
+	}
+	return action;
+}
+
+bool ActionLog::save(const std::string& path) const {
+	std::string data(MAGIC, sizeof(MAGIC));
+	data.push_back((char)VERSION);
+	data.push_back((char)(with_hashes ? 1 : 0));
+	write_fixed(data, seed);
+	write_varint(data, scenario.size());
+	data += scenario;
+	write_varint(data, records.size());
+	for (const Record& record : records) {
+		data.push_back((char)record.type);
+		if (record.type != Action::Type::EndTurn) {
+			write_varint(data, record.unit.slot);
+			write_varint(data, record.unit.generation);
+			write_zigzag(data, record.pos.x);
+			write_zigzag(data, record.pos.y);
+			write_zigzag(data, record.type == Action::Type::Move ? record.segment : record.weapon);
+		}
+		if (with_hashes) write_fixed(data, record.hash);
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.write(data.data(), data.size())) {
+		std::cout << "Couldn't write action log " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool ActionLog::load(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (!file || data.size() < sizeof(MAGIC) + 2 || data.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0) {
+		std::cout << "Couldn't read action log " << path << std::endl;
+		return false;
+	}
+
+	Reader reader { data, sizeof(MAGIC) };
+	if (reader.byte() != VERSION) {
+		std::cout << "Unsupported action log version in " << path << std::endl;
+		return false;
+	}
+	with_hashes = reader.byte() != 0;
+	seed = reader.fixed();
+	scenario.clear();
+	size_t length = reader.varint();
+	for (size_t i = 0; i < length && reader.ok; i++) {
+		scenario.push_back((char)reader.byte());
+	}
+	size_t count = reader.varint();
+
+	records.clear();
+	for (size_t i = 0; i < count && reader.ok; i++) {
+		Record record { (Action::Type)reader.byte(), UnitHandle(), Pos2(), 0, 0, NO_HASH };
+		if (record.type != Action::Type::EndTurn) {
+			record.unit.slot = (uint32_t)reader.varint();
+			record.unit.generation = (uint32_t)reader.varint();
+			record.pos.x = (int)reader.zigzag();
+			record.pos.y = (int)reader.zigzag();
+			int extra = (int)reader.zigzag();
+			if (record.type == Action::Type::Move) record.segment = extra;
+			else record.weapon = (uint8_t)extra;
+		}
+		if (with_hashes) record.hash = reader.fixed();
+		records.push_back(record);
+	}
+	if (!reader.ok) {
+		std::cout << "Truncated action log " << path << std::endl;
+		return false;
+	}
+	return true;
+}
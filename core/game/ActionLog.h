@@ -0,0 +1,63 @@
+#ifndef SPENCE_ACTIONLOG_H
+#define SPENCE_ACTIONLOG_H
+
+#include <string>
+#include <vector>
+#include "IEventHandler.h"
+#include "Map.h"
+
+/// Scenario and seed plus every action applied to a game, in order, optionally with a hash of the game state
+/// after each one. Stored as a compact binary file: a header, then one varint-packed record per
+/// action.
+class ActionLog {
+public:
+	static const uint64_t NO_HASH = 0;
+
+	struct Record {
+		Action::Type type;
+		UnitHandle unit;
+		Pos2 pos;
+		int segment;
+		uint8_t weapon;  // index into the unit's weapons
+		uint64_t hash;
+	};
+
+	explicit ActionLog(uint64_t seed = 0, bool with_hashes = false):
+		seed(seed), with_hashes(with_hashes) { }
+
+	inline uint64_t get_seed() const {
+		return seed;
+	}
+	inline bool has_hashes() const {
+		return with_hashes;
+	}
+	/// Scenario::to_string() of the game played; empty for the default scenario.
+	inline const std::string& get_scenario() const {
+		return scenario;
+	}
+	inline void set_scenario(const std::string& new_scenario) {
+		scenario = new_scenario;
+	}
+	inline size_t size() const {
+		return records.size();
+	}
+	inline const Record& operator[](size_t i) const {
+		return records[i];
+	}
+
+	void add(const Action& action, size_t weapon, uint64_t hash = NO_HASH);
+	/// The ith action, with its weapon looked up on the map.
+	Action get_action(size_t i, const Map& map) const;
+
+	bool save(const std::string& path) const;
+	bool load(const std::string& path);
+
+private:
+	uint64_t seed;
+	bool with_hashes;
+	std::string scenario;
+	std::vector<Record> records;
+};
+
+
+#endif //SPENCE_ACTIONLOG_H
@@ -0,0 +1,58 @@
+#include "Combat.h"
+#include <algorithm>
+
+int Combat::probability(const Map& map, const UnitType& type, Pos2 pos, const Weapon& weapon, Pos2 target) {
+	double distance = (pos - target).length();
+	int probability = weapon.apply_range(type.accuracy(), distance);
+
+	auto dirs = (pos - target).dirs();
+	for (Dir dir : dirs) {
+		if (map.has_cover(target, dir)) {
+			probability -= 30;
+			break;
+		}
+	}
+
+	if (!map.is_lit(target)) {
+		probability -= 20;
+	}
+
+	// TODO: step out, good angles?
+
+	return std::max(probability, 0);
+}
+
+bool Combat::best_attack(const Map& map, const Unit& attacker, Weapon*& weapon, Pos2& target) {
+	Side enemy = attacker.side() == Side::You ? Side::Enemy : Side::You;
+	Pos2 pos = attacker.pos();
+	float best = 0;
+	for (Weapon* candidate : attacker.get_weapons()) {
+		float average_damage = (candidate->min_damage + candidate->max_damage) / 2.f;
+		double range = candidate->max_range(attacker.type().accuracy());
+		map.get_unit_index().for_each_in_range(enemy, pos, range, [&](UnitHandle, Pos2 enemy_pos) {
+			if (!attacker.can_see(enemy_pos)) return;
+			float expected = probability(map, attacker.type(), pos, *candidate, enemy_pos) * average_damage;
+			if (expected > best) {
+				best = expected;
+				weapon = candidate;
+				target = enemy_pos;
+			}
+		});
+	}
+	return best > 0;
+}
+
+int Combat::attack(Map& map, const Unit& attacker, const Weapon& weapon, Pos2 target, Rando& rando) {
+	Unit victim = map.get_unit(target);
+	if (!victim) return 0;
+
+	int chance = probability(map, attacker.type(), attacker.pos(), weapon, target);
+	if (rando.rand(0, 100) >= chance) return 0;
+
+	int damage = (int)rando.rand(weapon.min_damage, weapon.max_damage + 1);
+	victim.damage(damage);
+	if (victim.hp() <= 0) {
+		map.remove_unit(victim);
+	}
+	return damage;
+}
@@ -0,0 +1,24 @@
+#ifndef SPENCE_COMBAT_H
+#define SPENCE_COMBAT_H
+
+#include "Map.h"
+#include "Weapon.h"
+#include "Rando.h"
+
+class Combat {
+public:
+	/// Chance in percent for a unit of the given type at pos to hit whoever is at target with the weapon.
+	static int probability(const Map& map, const UnitType& type, Pos2 pos, const Weapon& weapon, Pos2 target);
+
+	/// Finds the weapon and enemy in range and in the attacker's FOV with the highest expected
+	/// damage, the same choice Game makes from its HitTable. Returns false if there is nothing to
+	/// shoot at.
+	static bool best_attack(const Map& map, const Unit& attacker, Weapon*& weapon, Pos2& target);
+
+	/// Rolls to hit and for damage against whoever is at target. Units brought to 0 hp are removed
+	/// from the map. Returns the damage dealt, 0 on a miss.
+	static int attack(Map& map, const Unit& attacker, const Weapon& weapon, Pos2 target, Rando& rando);
+};
+
+
+#endif //SPENCE_COMBAT_H
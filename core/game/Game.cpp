@@ -1,221 +1,348 @@
 #include <map/Fov.h>
+#include <map/MapGen.h>
 #include "Game.h"
-
-const int MAP_WIDTH = 50;
-const int MAP_HEIGHT = 50;
-const int SIGHT_RADIUS = 12;
+#include "Combat.h"
+#include "Profiler.h"
+#include "Parallel.h"
+#include "Zobrist.h"
+#include <algorithm>
+
+/// Free tiles around centre, nearest first, until count are found or the map runs out.
+static std::vector<Pos2> spawn_points(const Map& map, Pos2 centre, int count) {
+	std::vector<Pos2> points;
+	Pos2 size = map.get_size();
+	int max_ring = std::max(size.x, size.y);
+	for (int ring = 0; ring <= max_ring && (int)points.size() < count; ring++) {
+		std::vector<Pos2> offsets;
+		for (int y = -ring; y <= ring; y++) {
+			for (int x = -ring; x <= ring; x++) {
+				if (std::max(std::abs(x), std::abs(y)) == ring) offsets.emplace_back(x, y);
+			}
+		}
+		// closest first, then towards the other side of the map
+		std::sort(offsets.begin(), offsets.end(), [](Pos2 a, Pos2 b) {
+			int da = std::abs(a.x) + std::abs(a.y), db = std::abs(b.x) + std::abs(b.y);
+			if (da != db) return da < db;
+			if (a.x + a.y != b.x + b.y) return a.x + a.y > b.x + b.y;
+			return a.x < b.x;
+		});
+		for (Pos2 offset : offsets) {
+			Pos2 pos = centre + offset;
+			if (!map.in_bounds(pos) || map.get_unit(pos)) continue;
+			points.push_back(pos);
+			if ((int)points.size() == count) break;
+		}
+	}
+	return points;
+}
 
 void Game::init() {
-	map.reset(Pos2(MAP_WIDTH, MAP_HEIGHT));
+	MapGen::generate(map, rando.rand(), scenario.gen);
+	if (log != nullptr) log->set_scenario(scenario.to_string());
+	MonteCarloSettings ai_settings = ai.get_settings();
+	ai_settings.sight_radius = scenario.sight_radius;
+	ai.set_settings(ai_settings);
 
 	Weapon& blunderbuss = create_weapon("Blunderbuss", 3, 5, RangeType::Short);
 	Weapon& musket = create_weapon("Musket", 3, 4, RangeType::Long);
 	Weapon& crossbow = create_weapon("Crossbow", 2, 4, RangeType::Long, true);
 	Weapon& sword = create_weapon("Sword", 3, 4, RangeType::Melee, true);
 	Weapon& dagger = create_weapon("Dagger", 2, 3, RangeType::Melee, true);
+	Weapon& bite = create_weapon("Bite", 1, 3, RangeType::Melee, true);
+	Weapon& spit = create_weapon("Spit", 1, 2, RangeType::Short);
+	Weapon& fire = create_weapon("Fire", 2, 4, RangeType::Medium);
 
-	Unit& vanguard = map.create_unit(create_unit_type("Vanguard", 6, 6, 7), Side::You, Pos2(10, 10));
-	vanguard.add_weapon(sword);
-	vanguard.add_weapon(blunderbuss);
-
-	Unit& assassin = map.create_unit(create_unit_type("Assassin", 7, 6, 6), Side::You, Pos2(10, 11));
-	assassin.add_weapon(dagger);
-	assassin.add_weapon(crossbow);
-
-	Unit& hunter = map.create_unit(create_unit_type("Hunter", 6, 7, 6), Side::You, Pos2(11, 10));
-	hunter.add_weapon(musket);
-
+	UnitType& vanguard = create_unit_type("Vanguard", 6, 6, 7);
+	UnitType& assassin = create_unit_type("Assassin", 7, 6, 6);
+	UnitType& hunter = create_unit_type("Hunter", 6, 7, 6);
 	UnitType& newt = create_unit_type("Newt", 5, 6, 3);
 	UnitType& salamander = create_unit_type("Salamander", 6, 6, 5);
-	map.create_unit(newt, Side::Enemy, Pos2(40, 40));
-	map.create_unit(newt, Side::Enemy, Pos2(40, 41));
-	map.create_unit(salamander, Side::Enemy, Pos2(41, 40));
-
 
+	// each side spawns around a point a fifth of the way in from its corner, cycling through its roster
 	Pos2 size = map.get_size();
-
-	for (int i = 0; i < 14; i++) {
-		gen_rect();
+	std::vector<Pos2> your_spawns = spawn_points(map, size / 5, scenario.num_you);
+	for (size_t i = 0; i < your_spawns.size(); i++) {
+		switch (i % 3) {
+			case 0: {
+				Unit unit = map.create_unit(vanguard, Side::You, your_spawns[i]);
+				unit.add_weapon(sword);
+				unit.add_weapon(blunderbuss);
+			} break;
+			case 1: {
+				Unit unit = map.create_unit(assassin, Side::You, your_spawns[i]);
+				unit.add_weapon(dagger);
+				unit.add_weapon(crossbow);
+			} break;
+			case 2: {
+				Unit unit = map.create_unit(hunter, Side::You, your_spawns[i]);
+				unit.add_weapon(musket);
+			} break;
+		}
 	}
-	for (int i = 0; i < 4; i++) {
-		gen_light_circle(Pos2(rando.rand(0, size.x), rando.rand(0, size.y)), rando.rand(2, 6));
+	std::vector<Pos2> enemy_spawns = spawn_points(map, size * 4 / 5, scenario.num_enemy);
+	for (size_t i = 0; i < enemy_spawns.size(); i++) {
+		if (i % 3 == 2) {
+			Unit unit = map.create_unit(salamander, Side::Enemy, enemy_spawns[i]);
+			unit.add_weapon(bite);
+			unit.add_weapon(fire);
+		} else {
+			Unit unit = map.create_unit(newt, Side::Enemy, enemy_spawns[i]);
+			unit.add_weapon(bite);
+			unit.add_weapon(spit);
+		}
 	}
 
-	for (int y = 0; y < size.y; y++) {
-		for (int x = 0; x < size.x; x++) {
-			for (int dir = 0; dir < 4; ++dir) {
-				int r = rando.rand(0, 200);
-				if (r == 0) {
-					map.set_wall(Pos2(x, y), (Dir)dir, Wall::Blocking);
-				} else if (r == 1) {
-					map.set_wall(Pos2(x, y), (Dir)dir, Wall::Cover);
-				}
-			}
-		}
+	UnitStore& units = map.get_units();
+	std::vector<Grid<char>> fovs(units.size(), Grid<char>(Pos2()));
+	parallel_for(units.size(), [&](size_t i) {
+		fovs[i] = Fov::calc(map, units.pos(i), scenario.sight_radius);
+	});
+	for (size_t i = 0; i < units.size(); i++) {
+		units.set_fov(i, fovs[i]);
 	}
 
-	vanguard.set_fov(Fov::calc(map, vanguard.pos(), SIGHT_RADIUS));
-	assassin.set_fov(Fov::calc(map, assassin.pos(), SIGHT_RADIUS));
-	hunter.set_fov(Fov::calc(map, hunter.pos(), SIGHT_RADIUS));
+	turn_count = 0;
+	winner = Side::None;
+	over = false;
 	init_turn(Side::You);
+	update();
 }
 
-void Game::on_select(Unit* unit) {
-	if (unit == nullptr) {
+void Game::on_select(UnitHandle unit) {
+	selected_unit = unit;
+	if (unit.is_none()) {
 		ui.clear();
-		selected_unit = nullptr;
 	} else {
-		selected_unit = unit;
 		update_unit_info();
 	}
 }
 
 void Game::on_action(Action action) {
+	if (over || planning) return;
+	Unit unit = map.get_unit(action.unit);
+	if (!unit && action.type != Action::Type::EndTurn) return;
 	if (action.type == Action::Type::Move) {
-		on_move(*action.unit, action.pos, action.segment);
-	} else {
-		on_attack(*action.unit, *action.weapon, action.pos);
+		on_move(unit, action.pos, action.segment);
+	} else if (action.type == Action::Type::Attack) {
+		on_attack(unit, *action.weapon, action.pos);
+	} else if (action.type == Action::Type::EndTurn) {
+		end_turn();
+		update_unit_info();
+		update();
 	}
 }
 
 void Game::on_attack(Unit& unit, Weapon& weapon, Pos2 pos) {
-
+	if (unit.ap() <= 0) return;
+	// only visible enemies in range, the same targets the AI chooses from
+	Unit target = map.get_unit(pos);
+	if (!target || get_probability(unit, weapon, target) == -1) return;
+	attack_unit(unit, weapon, pos);
+	update_unit_info();
+	update();
 }
 
-int Game::get_probability(Unit& unit, Weapon& weapon, Unit& target) {
-	int probability = 80 + unit.type().aim * 2;
+void Game::attack_unit(Unit& unit, Weapon& weapon, Pos2 pos) {
+	Combat::attack(map, unit, weapon, pos, rando);
+	unit.set_ap(0); // shooting ends the unit's turn
 
-	double distance = (unit.pos() - target.pos()).length();
-	switch (weapon.range) {
-		case Melee:  probability = distance > 1 ? 0 : probability; break;
-		case Short:  probability += (int)(distance * -6) + 20; break;
-		case Medium: probability += (int)(distance * -4) + 10; break;
-		case Long:   probability += (int)(distance * -2); break;
-	}
+	Action action(Action::Type::Attack);
+	action.unit = unit.handle();
+	action.pos = pos;
+	WeaponList unit_weapons = unit.get_weapons();
+	record(action, std::find(unit_weapons.begin(), unit_weapons.end(), &weapon) - unit_weapons.begin());
+}
 
-	auto dirs = (unit.pos() - target.pos()).dirs();
-	for (Dir dir : dirs) {
-		if (map.has_cover(target.pos(), dir)) {
-			probability -= 30;
-			break;
+void Game::end_turn() {
+	bool had_ap = false;
+	UnitStore& units = map.get_units();
+	for (size_t i = 0; i < units.size(); i++) {
+		if (units.side(i) == turn && units.ap(i) > 0) {
+			units.set_ap(i, 0);
+			had_ap = true;
 		}
 	}
+	// a turn that ran out of AP by itself ends without being told to
+	if (had_ap) record(Action(Action::Type::EndTurn));
+}
 
-	if (!map.is_lit(target.pos())) {
-		probability -= 20;
-	}
+void Game::record(const Action& action, size_t weapon) {
+	if (log == nullptr) return;
+	log->add(action, weapon, log->has_hashes() ? state_hash() : ActionLog::NO_HASH);
+}
 
-	// TODO: step out, good angles?
+uint64_t Game::state_hash() const {
+	return map.get_hash() ^ Zobrist::key(Zobrist::Feature::Turn, (uint64_t)turn);
+}
 
-	return std::max(probability, 0);
+bool Game::best_attack(const Unit& unit, Weapon*& weapon, Pos2& target) {
+	hits.update();
+	WeaponList unit_weapons = unit.get_weapons();
+	float best = 0;
+	hits.for_each(unit.handle(), [&](size_t w, UnitHandle, Pos2 target_pos, int probability) {
+		float expected = probability * (unit_weapons[w]->min_damage + unit_weapons[w]->max_damage) / 2.f;
+		if (expected > best) {
+			best = expected;
+			weapon = unit_weapons[w];
+			target = target_pos;
+		}
+	});
+	return best > 0;
 }
 
-void Game::on_move(Unit& unit, Pos2 pos, int segment) {
-	int move_cost = segment + 1;
-	if (move_cost > unit.ap()) {
-		unit.use_stamina(1);
-		move_cost--;
+int Game::get_probability(const Unit& unit, Weapon& weapon, const Unit& target) {
+	hits.update();
+	WeaponList unit_weapons = unit.get_weapons();
+	for (size_t w = 0; w < unit_weapons.size(); w++) {
+		if (unit_weapons[w] != &weapon) continue;
+		return hits.get(unit.handle(), w, target.handle());
 	}
+	return -1;
+}
 
-	unit.modify_ap(-move_cost);
-	map.move(unit, pos);
-	unit.set_fov(Fov::calc(map, unit.pos(), SIGHT_RADIUS));
-
+void Game::on_move(Unit& unit, Pos2 pos, int segment) {
+	move_unit(unit, pos, segment, async);
 	update_unit_info();
 	update();
 }
 
+void Game::move_unit(Unit& unit, Pos2 pos, int segment, bool defer_fov) {
+	unit.spend_move(segment);
+	map.move(unit, pos);
+	refresh_fov(unit, defer_fov);
+	record(Action(unit, pos, segment));
+}
+
+void Game::refresh_fov(Unit& unit, bool defer) {
+	if (!defer) {
+		unit.set_fov(Fov::calc(map, unit.pos(), scenario.sight_radius));
+		return;
+	}
+
+	auto snapshot = std::make_shared<Map>(map.fork());
+	auto fov = std::make_shared<Grid<char>>(Pos2());
+	UnitHandle handle = unit.handle();
+	Pos2 pos = unit.pos();
+	int sight_radius = scenario.sight_radius;
+	jobs.submit([snapshot, fov, pos, sight_radius]() {
+		*fov = Fov::calc(*snapshot, pos, sight_radius);
+	}, [this, fov, handle, pos]() {
+		Unit moved = map.get_unit(handle);
+		if (!moved || moved.pos() != pos) return; // moved again, a later job has the FOV
+		moved.set_fov(*fov);
+		hits.invalidate(handle);
+		update_unit_info();
+	});
+}
+
 void Game::init_turn(Side new_turn) {
 	turn = new_turn;
 
-	for (auto& unit : map.get_units()) {
-		if (unit->side() == turn) {
-			unit->set_ap(3);
+	UnitStore& units = map.get_units();
+	for (size_t i = 0; i < units.size(); i++) {
+		if (units.side(i) == turn) {
+			units.set_ap(i, 3);
 		}
 	}
 
+	turn_count++;
+	hits.set_side(turn);
 	update_unit_info();
-
-	if (turn == Side::Enemy) {
-		enemy_turn();
-	}
 }
 
-void Game::enemy_turn() {
-	for (auto& unit : map.get_units()) {
-		if (unit->side() == turn) {
-			unit->set_ap(0);
-		}
-	}
+void Game::ai_turn() {
+	PROFILE("game.ai_turn");
+	play_ai_turn(ai.plan(map, turn, ai_rando));
+}
 
-	update();
+void Game::start_ai_turn() {
+	planning = true;
+	auto snapshot = std::make_shared<Map>(map.fork());
+	auto steps = std::make_shared<std::vector<TurnStep>>();
+	Side side = turn;
+	jobs.submit([this, snapshot, steps, side]() {
+		*steps = ai.plan(*snapshot, side, ai_rando);
+	}, [this, steps]() {
+		planning = false;
+		play_ai_turn(*steps);
+		update_unit_info();
+		update();
+	});
 }
 
-void Game::update() {
-	for (auto& unit : map.get_units()) {
-		if (unit->side() == turn && unit->ap() > 0) {
-			return;
+void Game::play_ai_turn(const std::vector<TurnStep>& steps) {
+	for (const TurnStep& step : steps) {
+		Unit unit = map.get_unit(step.unit);
+		if (step.segment >= 0 && !map.get_unit(step.dest)) {
+			move_unit(unit, step.dest, step.segment);
 		}
-	}
 
-	init_turn(turn == Side::You ? Side::Enemy : Side::You);
+		Weapon* weapon;
+		Pos2 target;
+		if (unit.ap() > 0 && best_attack(unit, weapon, target)) {
+			attack_unit(unit, *weapon, target);
+			if (check_winner()) return;
+		}
+	}
+	end_turn();
 }
 
-void Game::update_unit_info() {
-	ui.clear();
-	if (selected_unit == nullptr) return;
-
-	ui.set_entry(NAME, selected_unit->type().name);
-	ui.set_entry(HP, "HP: " + std::to_string(selected_unit->hp()));
-	ui.set_entry(AP, "AP: " + std::to_string(selected_unit->ap()));
-	ui.set_entry(STAMINA, "Stamina: " + std::to_string(selected_unit->stamina()));
-	ui.set_entry(MOV, "Mov: " + std::to_string(selected_unit->type().mov));
-	ui.set_entry(AIM, "Aim: " + std::to_string(selected_unit->type().aim));
+bool Game::check_winner() {
+	bool alive[3] = { };
+	const UnitStore& units = map.get_units();
+	for (size_t i = 0; i < units.size(); i++) {
+		alive[(int)units.side(i)] = true;
+	}
 
-	auto& unit_weapons = selected_unit->get_weapons();
-	for (size_t i = 0; i < unit_weapons.size(); i++) {
-		ui.set_entry(WEAPONS + i, unit_weapons[i]->name, Action(*selected_unit, *unit_weapons[i]));
+	if (!alive[(int)Side::You] || !alive[(int)Side::Enemy]) {
+		over = true;
+		winner = alive[(int)Side::You] ? Side::You : alive[(int)Side::Enemy] ? Side::Enemy : Side::None;
 	}
+	return over;
 }
 
-Wall Game::draw_rect_line(int length, bool dim, Pos2 offset, Dir dir, Wall selection) {
-	for (int i = 0; i < length; i++) {
-		int r = rando.rand(0, 10);
-		if (r == 0) {
-			continue;
-		} else if (r == 1) {
-			selection = (selection == Wall::Cover ? Wall::Blocking : Wall::Cover);
+void Game::update() {
+	while (!over) {
+		bool waiting = false;
+		const UnitStore& units = map.get_units();
+		for (size_t i = 0; i < units.size(); i++) {
+			if (units.side(i) == turn && units.ap(i) > 0) {
+				waiting = true;
+			}
 		}
 
-		int x = dim ? i : 0;
-		int y = dim ? 0 : i;
-		map.set_wall(Pos2(x + offset.x, y + offset.y), dir, selection);
+		if (check_winner()) {
+			break;
+		} else if (max_turns > 0 && turn_count >= max_turns && !waiting) {
+			over = true;
+		} else if (waiting && !ai_controlled[(int)turn]) {
+			return;
+		} else if (waiting && async) {
+			start_ai_turn();
+			return;
+		} else if (waiting) {
+			ai_turn();
+		} else {
+			init_turn(turn == Side::You ? Side::Enemy : Side::You);
+		}
 	}
-
-	return selection;
 }
 
-void Game::gen_rect() {
-	int wid = rando.rand(2, 12);
-	int hei = rando.rand(2, 12);
-	Pos2 offset(rando.rand(0, MAP_WIDTH - wid), rando.rand(0, MAP_HEIGHT - hei));
+void Game::update_unit_info() {
+	ui.clear();
+	Unit unit = map.get_unit(selected_unit);
+	if (!unit) return;
 
-	Wall selection = rando.rand(0, 2) ? Wall::Blocking : Wall::Cover;
+	ui.set_entry(NAME, unit.type().name);
+	ui.set_entry(HP, "HP: " + std::to_string(unit.hp()));
+	ui.set_entry(AP, "AP: " + std::to_string(unit.ap()));
+	ui.set_entry(STAMINA, "Stamina: " + std::to_string(unit.stamina()));
+	ui.set_entry(MOV, "Mov: " + std::to_string(unit.type().mov));
+	ui.set_entry(AIM, "Aim: " + std::to_string(unit.type().aim));
 
-	draw_rect_line(wid, true, offset, Dir::North, selection);
-	draw_rect_line(hei, false, offset, Dir::West, selection);
-	draw_rect_line(hei, false, Pos2(offset.x + wid, offset.y), Dir::West, selection);
-	draw_rect_line(wid, true, Pos2(offset.x, offset.y + hei), Dir::North, selection);
-}
-
-void Game::gen_light_circle(Pos2 pos, int radius) {
-	for (int y = pos.y - radius; y <= pos.y + radius; y++) {
-		for (int x = pos.x - radius; x <= pos.x + radius; x++) {
-			Pos2 pos0(x, y);
-			if (map.in_bounds(pos0) && (pos - pos0).sqr_length() < radius * radius) {
-				map.add_light(pos0);
-			}
-		}
+	WeaponList unit_weapons = unit.get_weapons();
+	for (size_t i = 0; i < unit_weapons.size(); i++) {
+		ui.set_entry(WEAPONS + i, unit_weapons[i]->name, Action(unit, *unit_weapons[i]));
 	}
 }
 
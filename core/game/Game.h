@@ -6,42 +6,124 @@
 #include "UI.h"
 #include "Map.h"
 #include "Weapon.h"
+#include "MonteCarloAI.h"
+#include "HitTable.h"
+#include "ActionLog.h"
+#include "JobQueue.h"
+#include "Scenario.h"
 
 class Game : public IEventHandler {
 public:
-	Game(Map& map, UI& ui): map(map), ui(ui), rando(time(nullptr)) { }
+	Game(Map& map, UI& ui, uint64_t seed = time(nullptr)):
+		map(map), ui(ui), seed(seed), rando(seed), ai_rando(rando.split()), hits(map) {
+		ai_controlled[(int)Side::Enemy] = true;
+	}
+
+	/// Takes effect on the next init().
+	inline void set_scenario(const Scenario& new_scenario) {
+		scenario = new_scenario;
+	}
+	inline const Scenario& get_scenario() const {
+		return scenario;
+	}
 
 	void init();
-	void on_select(Unit* unit) override;
+	void on_select(UnitHandle unit) override;
 	void on_action(Action action) override;
-	int get_probability(Unit& unit, Weapon& weapon, Unit& target) override;
+	int get_probability(const Unit& unit, Weapon& weapon, const Unit& target) override;
+
+	/// Whether the AI plays the side's turns instead of waiting for actions. Only the enemy by default.
+	inline void set_ai_controlled(Side side, bool controlled) {
+		ai_controlled[(int)side] = controlled;
+	}
+	inline MonteCarloAI& get_ai() {
+		return ai;
+	}
+	/// Ends the game as a draw after this many turns (both sides count); 0 for no limit.
+	inline void set_max_turns(int turns) {
+		max_turns = turns;
+	}
+
+	inline bool is_over() const {
+		return over;
+	}
+	inline Side get_winner() const {
+		return winner;
+	}
+	inline int get_turn_count() const {
+		return turn_count;
+	}
+
+	inline uint64_t get_seed() const {
+		return seed;
+	}
+	/// Appends every action applied from now on, including the AI's, to the log.
+	inline void set_log(ActionLog* new_log) {
+		log = new_log;
+	}
+	/// Moves slow follow-ups (the FOV of a unit the player moved, AI planning) onto a background
+	/// thread so actions return straight away; their results are applied by poll(). Off by default.
+	inline void set_async(bool enabled) {
+		async = enabled;
+	}
+	/// Applies the results of finished background work. Call every frame when async.
+	inline void poll() {
+		jobs.poll();
+	}
+	inline bool is_busy() const {
+		return jobs.pending() > 0;
+	}
+
+	/// Zobrist hash of the map, units and whose turn it is. O(1), so it can be taken after every
+	/// action to spot replays that diverge, or used as a key to cache anything derived from the state.
+	uint64_t state_hash() const;
 
 private:
 	enum Info { NAME, B1, HP, AP, STAMINA, B2, STR, MOV, AIM, B3, WEAPONS };
 	void update_unit_info();
 	void on_move(Unit& unit, Pos2 pos, int segment);
+	void move_unit(Unit& unit, Pos2 pos, int segment, bool defer_fov = false);
+	void refresh_fov(Unit& unit, bool defer);
 	void on_attack(Unit& unit, Weapon& weapon, Pos2 pos);
+	void attack_unit(Unit& unit, Weapon& weapon, Pos2 pos);
+	void end_turn();
+	void record(const Action& action, size_t weapon = 0);
+	bool best_attack(const Unit& unit, Weapon*& weapon, Pos2& target);
 
 	void init_turn(Side new_turn);
-	void enemy_turn();
+	void ai_turn();
+	void start_ai_turn();
+	void play_ai_turn(const std::vector<TurnStep>& steps);
+	bool check_winner();
 	void update();
 
-	Wall draw_rect_line(int length, bool dim, Pos2 offset, Dir dir, Wall selection);
-	void gen_rect();
-	void gen_light_circle(Pos2 pos, int radius);
-
 	UnitType& create_unit_type(std::string name, int mov, int aim, int hp);
 	Weapon& create_weapon(std::string name, int min_damage, int max_damage, RangeType range, bool silent = false);
 
 	Map& map;
 	UI& ui;
+	Scenario scenario;
+	uint64_t seed;
 	Rando rando;
+	Rando ai_rando;  // kept apart so planning doesn't change the dice
+	ActionLog* log = nullptr;
+	MonteCarloAI ai;
+	HitTable hits;
 
 	Side turn;
-	Unit* selected_unit = nullptr;
+	int turn_count = 0;
+	int max_turns = 0;
+	bool ai_controlled[3] = { };
+	bool over = false;
+	Side winner = Side::None;
+	UnitHandle selected_unit;
 
 	std::vector<std::unique_ptr<UnitType>> unit_types;
 	std::vector<std::unique_ptr<Weapon>> weapons;
+
+	bool async = false;
+	bool planning = false;
+	JobQueue jobs;  // last, so running jobs finish before anything they use is destroyed
 };
 
 #endif //SPENCE_GAME_H
@@ -0,0 +1,141 @@
+#include "HitTable.h"
+#include "Combat.h"
+#include "Profiler.h"
+
+HitTable::HitTable(Map& map): map(map), subscriber(map.get_changes().subscribe()) { }
+
+HitTable::~HitTable() {
+	map.get_changes().unsubscribe(subscriber);
+}
+
+void HitTable::set_side(Side new_side) {
+	side = new_side;
+	reset_rows();
+	update();
+}
+
+void HitTable::update() {
+	PROFILE("hit_table");
+	const UnitStore& units = map.get_units();
+	bool reset = false;
+	map.get_changes().drain(subscriber, [&](const MapChange& change) {
+		switch (change.type) {
+			case MapChange::Type::Reset:
+				reset = true;
+				break;
+			case MapChange::Type::Wall:
+			case MapChange::Type::Light:
+				touch_targets(change.top_left, change.bot_rite);
+				break;
+			case MapChange::Type::UnitCreated:
+			case MapChange::Type::UnitMoved:
+				if (!units.valid(change.unit)) break;
+				if (units.side(units.index(change.unit)) == side) {
+					if (rows.size() <= change.unit.slot) rows.resize(change.unit.slot + 1);
+					rows[change.unit.slot].attacker = change.unit;
+					rows[change.unit.slot].dirty = true;
+				} else if (change.type == MapChange::Type::UnitMoved) {
+					touch_reach(change.from);
+					touch_reach(change.to);
+				} else {
+					touch_reach(change.top_left);
+				}
+				break;
+			case MapChange::Type::UnitRemoved:
+				if (change.unit.slot < rows.size() && rows[change.unit.slot].attacker == change.unit) {
+					rows[change.unit.slot] = Row();
+				}
+				touch_targets(change.top_left, change.bot_rite);
+				break;
+		}
+	});
+	if (reset) {
+		reset_rows();
+	}
+
+	for (Row& row : rows) {
+		if (row.dirty && !row.attacker.is_none()) {
+			rebuild(row);
+		}
+	}
+}
+
+void HitTable::invalidate(UnitHandle attacker) {
+	if (attacker.slot < rows.size() && rows[attacker.slot].attacker == attacker) {
+		rows[attacker.slot].dirty = true;
+	}
+}
+
+int HitTable::get(UnitHandle attacker, size_t weapon, UnitHandle target) const {
+	const Row* row = get_row(attacker);
+	if (row == nullptr) return -1;
+	for (const Entry& entry : row->entries) {
+		if (entry.weapon == weapon && entry.target == target) return entry.probability;
+	}
+	return -1;
+}
+
+void HitTable::reset_rows() {
+	rows.clear();
+	const UnitStore& units = map.get_units();
+	for (size_t i = 0; i < units.size(); i++) {
+		if (units.side(i) != side) continue;
+		UnitHandle handle = units.handle(i);
+		if (rows.size() <= handle.slot) rows.resize(handle.slot + 1);
+		rows[handle.slot].attacker = handle;
+	}
+}
+
+const HitTable::Row* HitTable::get_row(UnitHandle attacker) const {
+	if (attacker.slot >= rows.size() || rows[attacker.slot].attacker != attacker) return nullptr;
+	return &rows[attacker.slot];
+}
+
+void HitTable::rebuild(Row& row) {
+	row.dirty = false;
+	row.entries.clear();
+	num_rebuilt++;
+
+	const UnitStore& units = map.get_units();
+	if (!units.valid(row.attacker)) {
+		row = Row();
+		return;
+	}
+	size_t i = units.index(row.attacker);
+	row.pos = units.pos(i);
+	row.reach = 0;
+
+	Side enemy = side == Side::You ? Side::Enemy : Side::You;
+	WeaponList weapons = units.get_weapons(i);
+	for (size_t w = 0; w < weapons.size(); w++) {
+		double range = weapons[w]->max_range(units.type(i).accuracy());
+		row.reach = std::max(row.reach, range);
+		map.get_unit_index().for_each_in_range(enemy, row.pos, range, [&](UnitHandle target, Pos2 target_pos) {
+			if (!units.can_see(i, target_pos)) return;
+			int probability = Combat::probability(map, units.type(i), row.pos, *weapons[w], target_pos);
+			row.entries.push_back(Entry { target, target_pos, (uint8_t)w, (uint8_t)std::min(probability, 255) });
+		});
+	}
+}
+
+void HitTable::touch_targets(Pos2 top_left, Pos2 bot_rite) {
+	for (Row& row : rows) {
+		if (row.dirty || row.attacker.is_none()) continue;
+		for (const Entry& entry : row.entries) {
+			Pos2 pos = entry.target_pos;
+			if (pos.x >= top_left.x && pos.x <= bot_rite.x && pos.y >= top_left.y && pos.y <= bot_rite.y) {
+				row.dirty = true;
+				break;
+			}
+		}
+	}
+}
+
+void HitTable::touch_reach(Pos2 pos) {
+	for (Row& row : rows) {
+		if (row.dirty || row.attacker.is_none()) continue;
+		if ((pos - row.pos).sqr_length() <= row.reach * row.reach) {
+			row.dirty = true;
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef SPENCE_HITTABLE_H
+#define SPENCE_HITTABLE_H
+
+#include "Map.h"
+#include "Weapon.h"
+
+/// Hit probability of every (attacker, weapon, visible target) for the side whose turn it is.
+/// Rows are kept per attacker and only recomputed when the map's change log reports a move, light
+/// or wall change that could affect them.
+class HitTable {
+public:
+	explicit HitTable(Map& map);
+	~HitTable();
+	HitTable(const HitTable&) = delete;
+	HitTable& operator=(const HitTable&) = delete;
+
+	/// Rebuilds the table for a new attacking side.
+	void set_side(Side side);
+	/// Applies pending map changes, recomputing the rows they touched.
+	void update();
+	/// Marks the attacker's row for recomputing on the next update, for changes the map doesn't
+	/// log such as a new FOV.
+	void invalidate(UnitHandle attacker);
+
+	/// Chance in percent, or -1 if the target is not a visible enemy in range of that weapon.
+	int get(UnitHandle attacker, size_t weapon, UnitHandle target) const;
+
+	/// Calls fn(size_t weapon, UnitHandle target, Pos2 target_pos, int probability) for each entry
+	/// of the attacker.
+	template<typename F>
+	void for_each(UnitHandle attacker, F fn) const {
+		const Row* row = get_row(attacker);
+		if (row == nullptr) return;
+		for (const Entry& entry : row->entries) {
+			fn(entry.weapon, entry.target, entry.target_pos, entry.probability);
+		}
+	}
+
+	/// Number of rows recomputed so far.
+	inline size_t get_num_rebuilt() const {
+		return num_rebuilt;
+	}
+
+private:
+	struct Entry {
+		UnitHandle target;
+		Pos2 target_pos;
+		uint8_t weapon;
+		uint8_t probability;
+	};
+	struct Row {
+		UnitHandle attacker;
+		Pos2 pos;
+		double reach = 0;   // longest range of any weapon
+		bool dirty = true;
+		std::vector<Entry> entries;
+	};
+
+	const Row* get_row(UnitHandle attacker) const;
+	void reset_rows();
+	void rebuild(Row& row);
+	void touch_targets(Pos2 top_left, Pos2 bot_rite);
+	void touch_reach(Pos2 pos);
+
+	Map& map;
+	ChangeLog::Subscriber subscriber;
+	Side side = Side::None;
+	std::vector<Row> rows;  // indexed by the attacker's handle slot
+	size_t num_rebuilt = 0;
+};
+
+
+#endif //SPENCE_HITTABLE_H
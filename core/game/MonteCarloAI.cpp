@@ -0,0 +1,139 @@
+#include "MonteCarloAI.h"
+#include "Combat.h"
+#include "Fov.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <chrono>
+#include <mutex>
+
+std::vector<TurnStep> MonteCarloAI::plan(const Map& map, Side side, Rando& rando) {
+	PROFILE("ai.montecarlo");
+	auto start = std::chrono::steady_clock::now();
+	auto deadline = start + std::chrono::microseconds((long long)(settings.budget_ms * 1000));
+	stats = MonteCarloStats();
+
+	std::vector<AIPlan> unit_plans = utility.plan(map, side);
+	// units the utility pass had no time for come last and just hold; they're left out of the
+	// search and take their turns after the searched plan
+	std::vector<TurnStep> held;
+	for (size_t i = utility.get_stats().num_planned; i < unit_plans.size(); i++) {
+		const AIChoice& choice = unit_plans[i].choices[0];
+		held.push_back(TurnStep { unit_plans[i].unit, choice.dest, choice.segment });
+	}
+	unit_plans.resize(utility.get_stats().num_planned);
+
+	std::vector<TurnStep> best_steps;
+	for (const AIPlan& unit_plan : unit_plans) {
+		const AIChoice& choice = unit_plan.choices[0];
+		best_steps.push_back(TurnStep { unit_plan.unit, choice.dest, choice.segment });
+	}
+	if (unit_plans.empty()) return held;
+
+	unsigned num_threads = num_workers(settings.threads);
+	std::vector<Rando> streams;
+	for (unsigned t = 0; t < num_threads; t++) {
+		streams.push_back(rando.split());
+	}
+
+	std::mutex mutex;
+	float best_value = -std::numeric_limits<float>::infinity();
+	parallel_for(num_threads, [&](size_t t) {
+		Rando& dice = streams[t];
+		std::vector<size_t> order(unit_plans.size());
+		std::vector<TurnStep> steps(unit_plans.size());
+		ScoreCache scores;
+		MonteCarloStats counts;
+
+		// the first worker starts from the greedy plan so there's always something to fall back on
+		bool greedy = t == 0;
+		do {
+			for (size_t i = 0; i < order.size(); i++) {
+				order[i] = i;
+			}
+			if (!greedy) {
+				for (size_t i = order.size() - 1; i > 0; i--) {
+					std::swap(order[i], order[dice.rand(0, i + 1)]);
+				}
+			}
+			for (size_t i = 0; i < order.size(); i++) {
+				const AIPlan& unit_plan = unit_plans[order[i]];
+				size_t choice = 0;
+				if (!greedy && dice.rand(0, 2) == 0) {
+					choice = (size_t)dice.rand(0, unit_plan.choices.size());
+				}
+				const AIChoice& c = unit_plan.choices[choice];
+				steps[i] = TurnStep { unit_plan.unit, c.dest, c.segment };
+			}
+			greedy = false;
+
+			float value = 0;
+			for (int s = 0; s < settings.samples; s++) {
+				value += rollout(map, steps, dice, scores, counts);
+				counts.num_rollouts++;
+			}
+			value /= std::max(settings.samples, 1);
+			counts.num_plans++;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (value > best_value) {
+				best_value = value;
+				best_steps = steps;
+			}
+		} while (std::chrono::steady_clock::now() < deadline);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.num_plans += counts.num_plans;
+		stats.num_rollouts += counts.num_rollouts;
+		stats.num_actions += counts.num_actions;
+		stats.num_cached += counts.num_cached;
+	}, num_threads);
+
+	best_steps.insert(best_steps.end(), held.begin(), held.end());
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return best_steps;
+}
+
+float MonteCarloAI::rollout(const Map& map, const std::vector<TurnStep>& steps, Rando& dice, ScoreCache& scores,
+                            MonteCarloStats& counts) const {
+	PROFILE("ai.rollout");
+	Map sim = map.fork();
+	float value = 0;
+
+	for (const TurnStep& step : steps) {
+		Unit unit = sim.get_unit(step.unit);
+		if (step.segment >= 0 && !sim.get_unit(step.dest)) {
+			unit.spend_move(step.segment);
+			sim.move(unit, step.dest);
+			// targets are picked from what the unit can see, as when the turn is played for real
+			unit.set_fov(Fov::calc(sim, unit.pos(), settings.sight_radius));
+			counts.num_actions++;
+		}
+
+		Weapon* weapon;
+		Pos2 target;
+		if (unit.ap() > 0 && Combat::best_attack(sim, unit, weapon, target)) {
+			UnitHandle victim = sim.get_unit(target).handle();
+			value += Combat::attack(sim, unit, *weapon, target, dice) * settings.damage_weight;
+			if (!sim.get_units().valid(victim)) {
+				value += settings.kill_weight;
+			}
+			unit.set_ap(0);
+			counts.num_actions++;
+		}
+	}
+
+	// different orders, destinations and dice often end up in the same state
+	auto cached = scores.find(sim.get_hash());
+	if (cached != scores.end()) {
+		counts.num_cached++;
+		return value + cached->second;
+	}
+	float position = 0;
+	for (const TurnStep& step : steps) {
+		Unit unit = sim.get_unit(step.unit);
+		position += utility.score(sim, unit, unit.pos()) * settings.position_weight;
+	}
+	if (scores.size() >= settings.cache_size) scores.clear();
+	scores.emplace(sim.get_hash(), position);
+	return value + position;
+}
@@ -0,0 +1,83 @@
+#ifndef SPENCE_MONTECARLOAI_H
+#define SPENCE_MONTECARLOAI_H
+
+#include <unordered_map>
+#include "UtilityAI.h"
+#include "Rando.h"
+
+struct MonteCarloSettings {
+	MonteCarloSettings() {
+		utility.budget_ms = 100;
+		utility.num_choices = 6;
+	}
+
+	double budget_ms = 300;       // wall time allowed for planning one turn, including utility scoring
+	unsigned threads = 0;         // 0 for one per core
+	int samples = 4;              // rollouts per candidate plan, each with its own dice
+	float damage_weight   = 1;    // per point of damage dealt
+	float kill_weight     = 10;   // per enemy killed
+	float position_weight = 1;    // per point of utility score at the final positions
+	size_t cache_size = 1 << 16;  // final position scores remembered per worker, by state hash
+	int sight_radius = 12;        // FOV of units after a simulated move; Game sets it from its scenario
+	AISettings utility;           // picks the destinations sampled from and scores where units end up
+};
+
+struct MonteCarloStats {
+	size_t num_plans = 0;      // candidate plans evaluated
+	size_t num_rollouts = 0;
+	size_t num_actions = 0;    // simulated moves and attacks over all rollouts
+	size_t num_cached = 0;     // rollouts that ended in a state already scored
+	double ms = 0;
+
+	inline double actions_per_sec() const {
+		return ms > 0 ? num_actions * 1000. / ms : 0;
+	}
+};
+
+/// One unit's part of a turn: an optional move, then the best attack from wherever it ends up.
+struct TurnStep {
+	UnitHandle unit;
+	Pos2 dest;
+	int segment;  // -1 to stay put
+};
+
+/// Plans a whole side's turn at once. Candidate plans (an order to act in and a destination per
+/// unit out of the UtilityAI's best) are simulated on forks of the map with real dice rolls, and
+/// the one with the best average outcome wins. Workers run until the deadline and the best plan
+/// found so far is returned, which is never worse than the greedy utility plan.
+class MonteCarloAI {
+public:
+	explicit MonteCarloAI(MonteCarloSettings settings = MonteCarloSettings()):
+		settings(settings), utility(settings.utility) { }
+
+	inline const MonteCarloSettings& get_settings() const {
+		return settings;
+	}
+	inline void set_settings(const MonteCarloSettings& new_settings) {
+		settings = new_settings;
+		utility.set_settings(settings.utility);
+	}
+	inline const MonteCarloStats& get_stats() const {
+		return stats;
+	}
+
+	/// Steps for every unit of the side with AP left, in the order they should be taken. Each
+	/// worker draws its dice from its own split of rando.
+	std::vector<TurnStep> plan(const Map& map, Side side, Rando& rando);
+
+private:
+	/// Position scores of rollout end states, keyed by Map::get_hash(). Only valid within one plan()
+	/// call: scoring also depends on unit FOVs, which rollouts recompute for the units they move but
+	/// which otherwise come from the planned map.
+	typedef std::unordered_map<uint64_t, float> ScoreCache;
+
+	float rollout(const Map& map, const std::vector<TurnStep>& steps, Rando& rando, ScoreCache& scores,
+	              MonteCarloStats& counts) const;
+
+	MonteCarloSettings settings;
+	MonteCarloStats stats;
+	UtilityAI utility;
+};
+
+
+#endif //SPENCE_MONTECARLOAI_H
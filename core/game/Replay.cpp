@@ -0,0 +1,43 @@
+#include "Replay.h"
+#include "Game.h"
+#include "Profiler.h"
+#include <chrono>
+
+ReplayResult Replay::run(const ActionLog& log) {
+	Map map;
+	return run(log, map, nullptr);
+}
+
+ReplayResult Replay::run(const ActionLog& log, Map& map, Renderer* renderer) {
+	PROFILE("replay");
+	auto start = std::chrono::steady_clock::now();
+	ReplayResult result;
+
+	if (renderer) map.set_renderer(*renderer);
+	UI ui;
+	Game game(map, ui, log.get_seed());
+	Scenario scenario;
+	if (!log.get_scenario().empty() && scenario.parse(log.get_scenario(), "logged scenario")) {
+		game.set_scenario(scenario);
+	}
+	game.set_ai_controlled(Side::Enemy, false);
+	// the game logs what it applies again, so hashes are taken at the same points as when recording
+	ActionLog replayed(log.get_seed(), log.has_hashes());
+	game.set_log(&replayed);
+	game.init();
+	if (renderer) renderer->render();
+
+	for (size_t i = 0; i < log.size(); i++) {
+		game.on_action(log.get_action(i, map));
+		result.num_actions++;
+		if (renderer) renderer->render();
+		if (replayed.size() != i + 1 || (log.has_hashes() && replayed[i].hash != log[i].hash)) {
+			result.diverged_at = i;
+			break;
+		}
+	}
+
+	result.final_hash = game.state_hash();
+	result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
@@ -0,0 +1,30 @@
+#ifndef SPENCE_REPLAY_H
+#define SPENCE_REPLAY_H
+
+#include "ActionLog.h"
+
+struct ReplayResult {
+	static const size_t NOT_DIVERGED = (size_t)-1;
+
+	size_t num_actions = 0;
+	size_t diverged_at = NOT_DIVERGED;  // first action whose state hash didn't match the log
+	uint64_t final_hash = 0;
+	double ms = 0;
+
+	inline bool diverged() const {
+		return diverged_at != NOT_DIVERGED;
+	}
+};
+
+/// Re-runs a logged game from its seed as fast as possible, with the AI switched off and every
+/// action taken from the log.
+class Replay {
+public:
+	static ReplayResult run(const ActionLog& log);
+	/// Replays onto the given map, drawing a frame with the renderer (if any) after setup and after
+	/// every action.
+	static ReplayResult run(const ActionLog& log, Map& map, Renderer* renderer);
+};
+
+
+#endif //SPENCE_REPLAY_H
@@ -0,0 +1,125 @@
+#include "Scenario.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static const char* PRESETS[] = { "skirmish", "large", "dense", "open", "stress" };
+
+bool Scenario::preset(const std::string& name, Scenario& scenario) {
+	Scenario result;
+	result.name = name;
+	if (name == "skirmish") {
+		// defaults
+	} else if (name == "large") {
+		result.gen.size = Pos2(200, 200);
+		result.num_you = result.num_enemy = 50;
+	} else if (name == "dense") {
+		result.gen.size = Pos2(100, 100);
+		result.gen.rect_density *= 3;
+		result.gen.wall_density *= 4;
+		result.gen.light_density *= 3;
+		result.num_you = result.num_enemy = 20;
+	} else if (name == "open") {
+		result.gen.size = Pos2(200, 200);
+		result.gen.rect_density = 0;
+		result.gen.wall_density = 0;
+		result.num_you = result.num_enemy = 100;
+		result.sight_radius = 20;
+	} else if (name == "stress") {
+		result.gen.size = Pos2(1000, 1000);
+		result.num_you = result.num_enemy = 2500;
+	} else {
+		return false;
+	}
+	scenario = result;
+	return true;
+}
+
+std::vector<std::string> Scenario::preset_names() {
+	return std::vector<std::string>(std::begin(PRESETS), std::end(PRESETS));
+}
+
+bool Scenario::find(const std::string& name_or_path, Scenario& scenario) {
+	if (preset(name_or_path, scenario)) return true;
+	Scenario result;
+	if (!result.load(name_or_path)) return false;
+	scenario = result;
+	return true;
+}
+
+bool Scenario::parse(const std::string& text, const std::string& source) {
+	std::istringstream lines(text);
+	std::string line;
+	for (int line_num = 1; std::getline(lines, line); line_num++) {
+		line = line.substr(0, line.find('#'));
+		size_t equals = line.find('=');
+		if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+		if (equals == std::string::npos) {
+			std::cout << source << ":" << line_num << ": expected key = value" << std::endl;
+			return false;
+		}
+
+		auto trim = [](std::string s) {
+			size_t first = s.find_first_not_of(" \t\r");
+			size_t last = s.find_last_not_of(" \t\r");
+			return first == std::string::npos ? std::string() : s.substr(first, last - first + 1);
+		};
+		std::string key = trim(line.substr(0, equals));
+		std::string value = trim(line.substr(equals + 1));
+		std::istringstream number(value);
+		bool ok = true;
+
+		if      (key == "preset")  ok = preset(value, *this);
+		else if (key == "name")    name = value;
+		else if (key == "width")   ok = (bool)(number >> gen.size.x);
+		else if (key == "height")  ok = (bool)(number >> gen.size.y);
+		else if (key == "you")     ok = (bool)(number >> num_you);
+		else if (key == "enemy")   ok = (bool)(number >> num_enemy);
+		else if (key == "sight")   ok = (bool)(number >> sight_radius);
+		else if (key == "rects")   ok = (bool)(number >> gen.rect_density);
+		else if (key == "walls")   ok = (bool)(number >> gen.wall_density);
+		else if (key == "lights")  ok = (bool)(number >> gen.light_density);
+		else if (key == "region")  ok = (bool)(number >> gen.region_size);
+		else {
+			std::cout << source << ":" << line_num << ": unknown key " << key << std::endl;
+			return false;
+		}
+		if (!ok) {
+			std::cout << source << ":" << line_num << ": bad value for " << key << ": " << value << std::endl;
+			return false;
+		}
+	}
+
+	if (gen.size.x <= 0 || gen.size.y <= 0 || gen.region_size <= 0 || num_you < 0 || num_enemy < 0 || sight_radius < 0) {
+		std::cout << source << ": sizes and counts must be positive" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool Scenario::load(const std::string& path) {
+	std::ifstream file(path);
+	if (!file) {
+		std::cout << "Couldn't open scenario " << path << std::endl;
+		return false;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+	return parse(text.str(), path);
+}
+
+std::string Scenario::to_string() const {
+	std::ostringstream out;
+	out.precision(17);
+	out << "name = " << name << "\n"
+	    << "width = " << gen.size.x << "\n"
+	    << "height = " << gen.size.y << "\n"
+	    << "you = " << num_you << "\n"
+	    << "enemy = " << num_enemy << "\n"
+	    << "sight = " << sight_radius << "\n"
+	    << "rects = " << gen.rect_density << "\n"
+	    << "walls = " << gen.wall_density << "\n"
+	    << "lights = " << gen.light_density << "\n"
+	    << "region = " << gen.region_size << "\n";
+	return out.str();
+}
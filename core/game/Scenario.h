@@ -0,0 +1,35 @@
+#ifndef SPENCE_SCENARIO_H
+#define SPENCE_SCENARIO_H
+
+#include <string>
+#include <vector>
+#include "MapGen.h"
+
+/// Everything Game::init needs to set up a match: map size and generation densities, how many units
+/// each side fields and how far they see. Can be written as "key = value" lines, e.g.
+///
+///     preset = large
+///     width = 300
+///     you = 80
+struct Scenario {
+	std::string name = "skirmish";
+	MapGenSettings gen;
+	int num_you = 3;
+	int num_enemy = 3;
+	int sight_radius = 12;
+
+	/// Built-in preset with the given name. Returns false if there is none.
+	static bool preset(const std::string& name, Scenario& scenario);
+	static std::vector<std::string> preset_names();
+	/// Preset with the given name, otherwise the scenario file at that path.
+	static bool find(const std::string& name_or_path, Scenario& scenario);
+
+	/// Applies "key = value" lines on top of this scenario. A "preset" key starts over from that preset.
+	bool parse(const std::string& text, const std::string& source = "scenario");
+	bool load(const std::string& path);
+	/// Text that parse() turns back into this scenario.
+	std::string to_string() const;
+};
+
+
+#endif //SPENCE_SCENARIO_H
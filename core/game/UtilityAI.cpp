@@ -0,0 +1,125 @@
+#include "UtilityAI.h"
+#include "Combat.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <limits>
+
+inline Side opponent(Side side) {
+	return side == Side::You ? Side::Enemy : Side::You;
+}
+
+inline float average_damage(const Weapon& weapon) {
+	return (weapon.min_damage + weapon.max_damage) / 2.f;
+}
+
+std::vector<AIPlan> UtilityAI::plan(const Map& map, Side side) {
+	PROFILE("ai.utility");
+	auto start = std::chrono::steady_clock::now();
+	auto deadline = start + std::chrono::microseconds((long long)(settings.budget_ms * 1000));
+
+	const UnitStore& units = map.get_units();
+	std::vector<AIPlan> plans;
+	for (size_t i = 0; i < units.size(); i++) {
+		if (units.side(i) == side && units.ap(i) > 0) {
+			plans.push_back(AIPlan { units.handle(i), { } });
+		}
+	}
+
+	// start where the last plan for this side ran out of budget, so every unit gets evaluated in turn
+	size_t& first = next_first[(int)side];
+	if (!plans.empty()) std::rotate(plans.begin(), plans.begin() + first % plans.size(), plans.end());
+
+	parallel_for(plans.size(), [&](size_t i) {
+		if (std::chrono::steady_clock::now() >= deadline) return;
+		plans[i].choices = plan_unit(map, map.get_unit(plans[i].unit));
+	}, settings.threads);
+
+	size_t num_total = plans.size();
+	size_t num_planned = 0;
+	for (AIPlan& plan : plans) {
+		if (!plan.choices.empty()) {
+			num_planned++;
+		} else {
+			// out of budget: hold, still shooting from where it stands
+			plan.choices.push_back(AIChoice { map.get_unit(plan.unit).pos(), -1, std::numeric_limits<float>::lowest() });
+		}
+	}
+	first = num_total > 0 ? (first % num_total + num_planned) % num_total : 0;
+	std::stable_sort(plans.begin(), plans.end(), [](const AIPlan& a, const AIPlan& b) {
+		return a.choices[0].score > b.choices[0].score;
+	});
+
+	stats.num_planned = num_planned;
+	stats.num_skipped = num_total - num_planned;
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return plans;
+}
+
+std::vector<AIChoice> UtilityAI::plan_unit(const Map& map, const Unit& unit) const {
+	PathSettings path_settings = settings.path_settings;
+	Pos2 pos = unit.pos();
+	PathMap path_map = Path::calc(map, pos, unit.move_radius(), path_settings, unit.move_segments());
+
+	std::vector<AIChoice> choices;
+	choices.push_back(AIChoice { pos, -1, score(map, unit, pos) });
+	int reach = (int)std::ceil(unit.move_radius()) + 1;
+	for (int y = pos.y - reach; y <= pos.y + reach; y++) {
+		for (int x = pos.x - reach; x <= pos.x + reach; x++) {
+			Pos2 dest(x, y);
+			PathNode* node = path_map.get_node(dest);
+			if (dest == pos || node == nullptr || node->state != PathNode::ACCESSABLE) continue;
+			if (map.get_unit(dest)) continue;
+			float cost = (float)(node->segment + 1) * settings.ap_weight;
+			choices.push_back(AIChoice { dest, node->segment, score(map, unit, dest) - cost });
+		}
+	}
+
+	size_t num_choices = std::min(std::max(settings.num_choices, (size_t)1), choices.size());
+	std::partial_sort(choices.begin(), choices.begin() + num_choices, choices.end(),
+	                  [](const AIChoice& a, const AIChoice& b) { return a.score > b.score; });
+	choices.resize(num_choices);
+	return choices;
+}
+
+float UtilityAI::score(const Map& map, const Unit& unit, Pos2 pos) const {
+	Side enemy = opponent(unit.side());
+	const UnitIndex& index = map.get_unit_index();
+	const UnitStore& units = map.get_units();
+	float score = 0;
+
+	float best_attack = 0;
+	for (Weapon* weapon : unit.get_weapons()) {
+		index.for_each_in_range(enemy, pos, weapon->max_range(unit.type().accuracy()), [&](UnitHandle, Pos2 target) {
+			float expected = Combat::probability(map, unit.type(), pos, *weapon, target) / 100.f * average_damage(*weapon);
+			best_attack = std::max(best_attack, expected);
+		});
+	}
+	score += best_attack * settings.attack_weight;
+
+	index.for_each_in_range(enemy, pos, settings.threat_radius, [&](UnitHandle threat, Pos2 threat_pos) {
+		size_t i = units.index(threat);
+		float worst = 0;
+		for (Weapon* weapon : units.get_weapons(i)) {
+			float expected = Combat::probability(map, units.type(i), threat_pos, *weapon, pos) / 100.f * average_damage(*weapon);
+			worst = std::max(worst, expected);
+		}
+		score -= worst * settings.threat_weight;
+
+		for (Dir dir : (threat_pos - pos).dirs()) {
+			if (map.has_cover(pos, dir)) {
+				score += settings.cover_weight;
+				break;
+			}
+		}
+	});
+
+	auto nearest = index.nearest(enemy, pos, 1);
+	if (!nearest.empty()) {
+		score -= (float)(units.pos(units.index(nearest[0])) - pos).length() * settings.approach_weight;
+	}
+
+	return score;
+}
@@ -0,0 +1,76 @@
+#ifndef SPENCE_UTILITYAI_H
+#define SPENCE_UTILITYAI_H
+
+#include "Map.h"
+#include "Path.h"
+
+struct AISettings {
+	AISettings() {
+		path_settings.diag_cost = 1.4;
+		path_settings.step_cost = 2;
+	}
+
+	double budget_ms = 100;       // wall time allowed for planning one turn
+	unsigned threads = 0;         // 0 for one per core
+	size_t num_choices = 4;       // destinations kept per unit in case better ones get taken
+	double threat_radius = 12;    // how far away enemies count as a threat
+	float attack_weight   = 1;    // per point of damage expected to be dealt from a destination
+	float threat_weight   = 1;    // per point of damage expected to be taken at a destination
+	float cover_weight    = 2;    // per threat a destination has cover against
+	float approach_weight = 0.2;  // per tile to the nearest enemy
+	float ap_weight       = 0.1;  // per action point spent getting there
+	PathSettings path_settings;
+};
+
+struct AIChoice {
+	Pos2 dest;
+	int segment;
+	float score;
+};
+
+struct AIPlan {
+	UnitHandle unit;
+	std::vector<AIChoice> choices; // best first
+};
+
+struct AIStats {
+	size_t num_planned = 0;
+	size_t num_skipped = 0;  // ran out of budget before getting to these, so they hold
+	double ms = 0;
+};
+
+/// Scores every reachable destination of each unit by the damage it could deal, the damage it
+/// could take, cover and distance to the enemy. Units are evaluated in parallel against a deadline.
+class UtilityAI {
+public:
+	explicit UtilityAI(AISettings settings = AISettings()): settings(settings) { }
+
+	inline const AISettings& get_settings() const {
+		return settings;
+	}
+	inline void set_settings(const AISettings& new_settings) {
+		settings = new_settings;
+	}
+	inline const AIStats& get_stats() const {
+		return stats;
+	}
+
+	/// Plans for every unit of the side with AP left, most promising first. Units that could not be
+	/// evaluated within the budget hold their position, last, and are evaluated first on the side's
+	/// next turn.
+	std::vector<AIPlan> plan(const Map& map, Side side);
+
+	/// Best destinations for one unit, best first.
+	std::vector<AIChoice> plan_unit(const Map& map, const Unit& unit) const;
+
+	/// Utility of the unit standing at pos.
+	float score(const Map& map, const Unit& unit, Pos2 pos) const;
+
+private:
+	AISettings settings;
+	AIStats stats;
+	size_t next_first[3] = { };  // per side, where in its units the next plan starts evaluating
+};
+
+
+#endif //SPENCE_UTILITYAI_H
@@ -9,6 +9,28 @@ struct Weapon {
 	Weapon(std::string name, int min_damage, int max_damage, RangeType range, bool silent = false):
 		name(std::move(name)), min_damage(min_damage), max_damage(max_damage), range(range), silent(silent) { }
 
+	/// Hit chance after adjusting the given base chance for distance to the target.
+	inline int apply_range(int probability, double distance) const {
+		switch (range) {
+			case Melee:  return distance > 1 ? 0 : probability;
+			case Short:  return probability + (int)(distance * -6) + 20;
+			case Medium: return probability + (int)(distance * -4) + 10;
+			case Long:   return probability + (int)(distance * -2);
+		}
+		return probability;
+	}
+
+	/// Distance past which apply_range leaves no chance to hit.
+	inline double max_range(int probability) const {
+		switch (range) {
+			case Melee:  return 1;
+			case Short:  return (probability + 20) / 6.;
+			case Medium: return (probability + 10) / 4.;
+			case Long:   return probability / 2.;
+		}
+		return 0;
+	}
+
 	std::string name;
 	int min_damage;
 	int max_damage;
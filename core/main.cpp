@@ -2,11 +2,31 @@
 #include "SFMLRenderer.h"
 #include "SFMLEventManager.h"
 #include "game/Game.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+
+const int IDLE_WAIT_MS = 15;
+
+int main(int argc, char** argv) {
+	Scenario scenario;
+	std::string record_path;  // action log of the session, only written if asked for
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			record_path = argv[++i];
+		} else if (argv[i][0] == '-' || !Scenario::find(argv[i], scenario)) {
+			std::cout << "usage: " << argv[0] << " [PRESET|FILE] [--record LOG]" << std::endl;
+			return 1;
+		}
+	}
 
-int main() {
 	Map map;
 	UI ui;
 	Game game(map, ui);
+	game.set_scenario(scenario);
+	ActionLog log(game.get_seed(), true);
+	if (!record_path.empty()) game.set_log(&log);
+	game.set_async(true);
 	game.init();
 	SFMLRenderer renderer(Pos2(1200, 800), 32, map, ui, game);
 	SFMLEventManager events(renderer);
@@ -14,8 +34,13 @@ int main() {
 	map.set_renderer(renderer);
 
 	while (renderer.get_window().isOpen()) {
-		events.update();
+		// sleep until there's input while nothing on screen needs redrawing, but wake up now and
+		// then for AI and path results from the background threads
+		events.update(renderer.needs_render() ? 0 : IDLE_WAIT_MS);
+		game.poll();
 		renderer.render();
 	}
+
+	if (!record_path.empty() && !log.save(record_path)) return 1;
 	return 0;
 }
@@ -0,0 +1,61 @@
+#include "ChangeLog.h"
+#include <algorithm>
+
+ChangeLog::Subscriber ChangeLog::subscribe() {
+	for (size_t i = 0; i < cursors.size(); i++) {
+		if (cursors[i] == UNSUBSCRIBED) {
+			cursors[i] = end_seq();
+			return i;
+		}
+	}
+	cursors.push_back(end_seq());
+	return cursors.size() - 1;
+}
+
+void ChangeLog::unsubscribe(Subscriber subscriber) {
+	cursors[subscriber] = UNSUBSCRIBED;
+	trim();
+}
+
+void ChangeLog::push(const MapChange& change) {
+	bool has_subscribers = false;
+	size_t max_cursor = 0;
+	for (size_t cursor : cursors) {
+		if (cursor == UNSUBSCRIBED) continue;
+		has_subscribers = true;
+		max_cursor = std::max(max_cursor, cursor);
+	}
+	if (!has_subscribers) return;
+
+	// only merge into an entry nobody has drained yet
+	if (!changes.empty() && max_cursor < end_seq() && changes.back().type == change.type) {
+		MapChange& last = changes.back();
+		bool merge = false;
+		if (change.type == MapChange::Type::Wall || change.type == MapChange::Type::Light) {
+			merge = change.top_left.x <= last.bot_rite.x + 1 && change.bot_rite.x >= last.top_left.x - 1 &&
+			        change.top_left.y <= last.bot_rite.y + 1 && change.bot_rite.y >= last.top_left.y - 1;
+		} else if (change.type == MapChange::Type::UnitMoved && change.unit == last.unit) {
+			// one move from where the unit started to where it ended up
+			last.to = change.to;
+			merge = true;
+		}
+		if (merge) {
+			last.top_left = last.top_left.min(change.top_left);
+			last.bot_rite = last.bot_rite.max(change.bot_rite);
+			return;
+		}
+	}
+
+	changes.push_back(change);
+}
+
+void ChangeLog::trim() {
+	size_t min_cursor = end_seq();
+	for (size_t cursor : cursors) {
+		if (cursor != UNSUBSCRIBED) min_cursor = std::min(min_cursor, cursor);
+	}
+	while (first_seq < min_cursor) {
+		changes.pop_front();
+		first_seq++;
+	}
+}
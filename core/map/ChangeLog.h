@@ -0,0 +1,78 @@
+#ifndef SPENCE_CHANGELOG_H
+#define SPENCE_CHANGELOG_H
+
+#include <deque>
+#include <vector>
+#include "Vec.h"
+#include "../UnitStore.h"
+
+struct MapChange {
+	enum class Type : uint8_t {
+		Reset,
+		Wall,
+		Light,
+		UnitCreated,
+		UnitMoved,
+		UnitRemoved,
+	};
+
+	MapChange(Type type, Pos2 top_left, Pos2 bot_rite, UnitHandle unit = UnitHandle()):
+		type(type), unit(unit), top_left(top_left), bot_rite(bot_rite) { }
+
+	inline bool contains(Pos2 pos) const {
+		return pos.x >= top_left.x && pos.x <= bot_rite.x && pos.y >= top_left.y && pos.y <= bot_rite.y;
+	}
+
+	Type type;
+	UnitHandle unit;
+	Pos2 from, to;     // UnitMoved only
+	Pos2 top_left;     // affected tiles, inclusive
+	Pos2 bot_rite;
+};
+
+/// Batched log of map mutations. Each subscriber drains the changes made since its last drain;
+/// entries are dropped once every subscriber has seen them, and nothing is kept without subscribers.
+class ChangeLog {
+public:
+	typedef size_t Subscriber;
+
+	Subscriber subscribe();
+	void unsubscribe(Subscriber subscriber);
+
+	/// Appends a change, merging wall and light changes into the previous entry when they touch, and
+	/// a unit's move into the previous entry when that was the same unit's move.
+	void push(const MapChange& change);
+
+	/// Entries kept for the subscriber furthest behind.
+	inline size_t size() const {
+		return changes.size();
+	}
+	inline bool has_changes(Subscriber subscriber) const {
+		return cursors[subscriber] < end_seq();
+	}
+
+	/// Calls fn(const MapChange&) for each change since the subscriber's last drain.
+	template<typename F>
+	void drain(Subscriber subscriber, F fn) {
+		for (size_t seq = cursors[subscriber]; seq < end_seq(); seq++) {
+			fn(changes[seq - first_seq]);
+		}
+		cursors[subscriber] = end_seq();
+		trim();
+	}
+
+private:
+	static const size_t UNSUBSCRIBED = (size_t)-1;
+
+	inline size_t end_seq() const {
+		return first_seq + changes.size();
+	}
+	void trim();
+
+	std::deque<MapChange> changes;
+	size_t first_seq = 0;
+	std::vector<size_t> cursors;
+};
+
+
+#endif //SPENCE_CHANGELOG_H
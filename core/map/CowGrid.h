@@ -0,0 +1,65 @@
+#ifndef SPENCE_COWGRID_H
+#define SPENCE_COWGRID_H
+
+#include "Grid.h"
+#include "../util/CowArray.h"
+
+/// 2D grid stored in square copy-on-write chunks, so copies share every chunk not written since.
+template<typename T, int CHUNK = 16>
+class CowGrid {
+public:
+	static const int CHUNK_SIZE = CHUNK;
+
+	explicit CowGrid(Pos2 size, T def = T()): size(size), def(def),
+		chunks_x((size.x + CHUNK - 1) / CHUNK),
+		cells((size_t)chunks_x * (size_t)((size.y + CHUNK - 1) / CHUNK) * CHUNK * CHUNK, def) {
+		assert(size.x >= 0 && size.y >= 0);
+	}
+	explicit CowGrid(const Grid<T>& grid, T def = T()): CowGrid(grid.get_size(), def) {
+		assert(grid.get_offset() == Pos2());
+		for (int y = 0; y < size.y; y++) {
+			for (int x = 0; x < size.x; x++) {
+				cells.set(idx(Pos2(x, y)), grid.get(Pos2(x, y)));
+			}
+		}
+	}
+	Pos2 get_size() const { return size; }
+	bool in_bounds(Pos2 pos) const {
+		return pos.x >= 0 && pos.x < size.x && pos.y >= 0 && pos.y < size.y;
+	}
+
+	const T& get(Pos2 pos) const {
+		if (!in_bounds(pos)) return def;
+		return cells.get(idx(pos));
+	}
+	const T& operator[](Pos2 pos) const { return get(pos); }
+
+	/// Writable reference to an in-bounds cell, unsharing its chunk if needed.
+	T& mut(Pos2 pos) {
+		assert(in_bounds(pos));
+		return cells.mut(idx(pos));
+	}
+	void set(Pos2 pos, T val) {
+		if (!in_bounds(pos)) return;
+		mut(pos) = val;
+	}
+
+	/// Whether the chunk holding pos is shared with other, so none of its cells can differ. Grids
+	/// forked from each other only stop sharing the chunks written to since.
+	bool shares_chunk(const CowGrid& other, Pos2 pos) const {
+		return size == other.size && cells.shares_chunk(other.cells, idx(pos) / ((size_t)CHUNK * CHUNK));
+	}
+
+private:
+	inline size_t idx(Pos2 pos) const {
+		size_t chunk = (size_t)(pos.y / CHUNK) * chunks_x + pos.x / CHUNK;
+		return chunk * CHUNK * CHUNK + (pos.y % CHUNK) * CHUNK + pos.x % CHUNK;
+	}
+
+	Pos2 size;
+	T def;
+	int chunks_x;
+	CowArray<T, (size_t)CHUNK * CHUNK> cells;
+};
+
+#endif //SPENCE_COWGRID_H
@@ -1,4 +1,5 @@
 #include "Fov.h"
+#include "../util/Profiler.h"
 #include <list>
 #include <algorithm>
 #include <limits>
@@ -324,6 +325,7 @@ bool ray_cast2(const Map& map, Vec2 fr, Vec2 to) {
 }
 
 Grid<char> Fov::calc(const Map& map, Pos2 pos, int radius) {
+	PROFILE("fov");
 	/*Pos2 top_left = (pos - Pos2(radius)).max(Pos2());
 	Pos2 bot_rite = (pos + Pos2(radius)).max(map.get_size());
 	Grid<char> fov_grid(bot_rite - top_left, false, top_left);
@@ -337,7 +339,7 @@ Grid<char> Fov::calc(const Map& map, Pos2 pos, int radius) {
 	return fov_grid;*/
 
 	Pos2 top_left = (pos - Pos2(radius)).max(Pos2());
-	Pos2 bot_rite = (pos + Pos2(radius)).max(map.get_size());
+	Pos2 bot_rite = (pos + Pos2(radius + 1)).min(map.get_size());
 	//Grid<char> north_wall_fov(bot_rite - top_left, false, top_left);
 	//Grid<char> west_wall_fov(bot_rite - top_left, false, top_left);
 	Grid<char> fov_grid(bot_rite - top_left, false, top_left);
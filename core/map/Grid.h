@@ -34,6 +34,8 @@ public:
 	      T& operator[](Pos2 pos)       { return get(pos); }
 	const T& operator[](Pos2 pos) const { return get(pos); }
 
+	const T* data() const { return cells.data(); }
+
 	void set(Pos2 pos, T val) {
 		if (!in_bounds(pos)) return;
 		get(pos) = val;
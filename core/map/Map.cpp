@@ -1,16 +1,50 @@
 #include <cassert>
 #include "Map.h"
+#include "Zobrist.h"
 
-Map::Map(): grid(Pos2()), unit_grid(Pos2(), nullptr), light_grid(Pos2(), 0) { }
+Map::Map(): grid(Pos2()), unit_grid(Pos2()), light_grid(Pos2(), 0) { }
+
+Map::Map(const Map& other): grid(other.grid), units(other.units), unit_grid(other.unit_grid),
+	unit_index(other.unit_index), light_grid(other.light_grid), hash(other.hash) { }
+
+Map Map::fork() const {
+	return Map(*this);
+}
+
+void Map::restore(const Map& snapshot) {
+	grid = snapshot.grid;
+	units = snapshot.units;
+	unit_grid = snapshot.unit_grid;
+	unit_index = snapshot.unit_index;
+	light_grid = snapshot.light_grid;
+	hash = snapshot.hash;
+	changes.push(MapChange(MapChange::Type::Reset, Pos2(), get_size() - Pos2(1)));
+}
 
 void Map::set_renderer(Renderer& r) {
 	renderer = &r;
 }
 
 void Map::reset(Pos2 size) {
-	grid = Grid<Tile>(size);
-	unit_grid = Grid<Unit*>(size, nullptr);
-	light_grid = Grid<short>(size, 0);
+	reset(Grid<Tile>(size), Grid<short>(size, 0));
+}
+
+void Map::reset(const Grid<Tile>& tiles, const Grid<short>& light) {
+	Pos2 size = tiles.get_size();
+	grid = CowGrid<Tile>(tiles);
+	units.clear();
+	unit_grid = CowGrid<UnitHandle>(size);
+	unit_index.reset(size);
+	light_grid = CowGrid<short>(light, 0);
+	hash = 0;
+	for (int y = 0; y < size.y; y++) {
+		for (int x = 0; x < size.x; x++) {
+			Pos2 pos(x, y);
+			hash ^= wall_key(pos, Dir::North, tiles[pos].north_wall) ^ wall_key(pos, Dir::West, tiles[pos].west_wall);
+			if (light[pos] > 0) hash ^= light_key(pos);
+		}
+	}
+	changes.push(MapChange(MapChange::Type::Reset, Pos2(), size - Pos2(1)));
 	if (renderer) renderer->reset_grid(grid);
 }
 
@@ -31,38 +65,87 @@ Wall Map::get_wall(Pos2 pos, Dir dir) const {
 	return Wall::None;
 }
 
-Wall& Map::get_wall(Pos2 pos, Dir dir) {
-	static Wall wall_none = Wall::None;
-	Tile& tile = grid.get(pos);
+Wall& Map::wall_ref(Pos2 pos, Dir dir) {
 	switch (dir) {
-		case Dir::North: return tile.north_wall;
-		case Dir::West:  return tile.west_wall;
-		case Dir::South: {
-			Pos2 south_pos = pos + Pos2(0, 1);
-			return in_bounds(south_pos) ? grid.get(south_pos).north_wall : wall_none;
-		}
-		case Dir::East: {
-			Pos2 east_pos = pos + Pos2(1, 0);
-			return in_bounds(east_pos) ? grid.get(east_pos).west_wall : wall_none;
-		}
+		case Dir::North: return grid.mut(pos).north_wall;
+		case Dir::West:  return grid.mut(pos).west_wall;
+		case Dir::South: return grid.mut(pos + Pos2(0, 1)).north_wall;
+		case Dir::East:  return grid.mut(pos + Pos2(1, 0)).west_wall;
+	}
+	assert(false);
+	return grid.mut(pos).north_wall;  // unreachable
+}
+
+uint64_t Map::wall_key(Pos2 pos, Dir dir, Wall wall) {
+	if (wall == Wall::None) return 0;
+	// a wall is stored on the tile south or east of it, so key it the same way from either side
+	if (dir == Dir::South || dir == Dir::East) {
+		pos = pos + Pos2(dir);
+		dir = flip(dir);
 	}
-	return wall_none;
+	return Zobrist::key(Zobrist::Feature::Wall, Zobrist::pack(pos), ((uint64_t)dir << 8) | (uint64_t)wall);
+}
+
+uint64_t Map::light_key(Pos2 pos) {
+	return Zobrist::key(Zobrist::Feature::Light, Zobrist::pack(pos));
 }
 
 void Map::set_wall(Pos2 pos, Dir dir, Wall wall) {
-	get_wall(pos, dir) = wall;
+	Pos2 other = pos + Pos2(dir);
+	if (!in_bounds(pos) || ((dir == Dir::South || dir == Dir::East) && !in_bounds(other))) return;
+
+	Wall& ref = wall_ref(pos, dir);
+	if (ref == wall) return;
+	hash ^= wall_key(pos, dir, ref) ^ wall_key(pos, dir, wall);
+	ref = wall;
+	changes.push(MapChange(MapChange::Type::Wall, pos.min(other).max(Pos2()), pos.max(other).min(get_size() - Pos2(1))));
 }
 
-Unit& Map::create_unit(const UnitType& type, Side side, Pos2 pos) {
-	units.push_back(std::make_unique<Unit>(type, side, pos));
-	unit_grid.set(pos, units.back().get());
-	return *units.back();
+Unit Map::create_unit(const UnitType& type, Side side, Pos2 pos) {
+	UnitHandle handle = units.create(type, side, pos);
+	unit_grid.set(pos, handle);
+	unit_index.insert(handle, side, pos);
+	changes.push(MapChange(MapChange::Type::UnitCreated, pos, pos, handle));
+	return units.get(handle);
 }
 
 void Map::move(const Unit& unit, Pos2 pos) {
-	Unit* mut_unit = unit_grid.get(unit.pos());
-	assert(mut_unit != nullptr);
-	unit_grid.set(unit.pos(), nullptr);
-	mut_unit->set_pos(pos);
-	unit_grid.set(pos, mut_unit);
+	assert(unit_grid.get(unit.pos()) == unit.handle());
+	Pos2 from = unit.pos();
+	size_t i = units.index(unit.handle());
+	unit_grid.set(from, UnitHandle());
+	units.set_pos(i, pos);
+	unit_grid.set(pos, unit.handle());
+	unit_index.move(unit.handle(), units.side(i), from, pos);
+
+	MapChange change(MapChange::Type::UnitMoved, from.min(pos), from.max(pos), unit.handle());
+	change.from = from;
+	change.to = pos;
+	changes.push(change);
+}
+
+void Map::remove_unit(const Unit& unit) {
+	Pos2 pos = unit.pos();
+	UnitHandle handle = unit.handle();
+	assert(unit_grid.get(pos) == handle);
+	unit_grid.set(pos, UnitHandle());
+	unit_index.remove(handle, unit.side(), pos);
+	units.destroy(handle);
+	changes.push(MapChange(MapChange::Type::UnitRemoved, pos, pos, handle));
+}
+
+void Map::add_light(Pos2 pos) {
+	if (!in_bounds(pos)) return;
+	if (light_grid.mut(pos)++ == 0) {
+		hash ^= light_key(pos);
+		changes.push(MapChange(MapChange::Type::Light, pos, pos));
+	}
+}
+
+void Map::remove_light(Pos2 pos) {
+	if (!in_bounds(pos)) return;
+	if (--light_grid.mut(pos) == 0) {
+		hash ^= light_key(pos);
+		changes.push(MapChange(MapChange::Type::Light, pos, pos));
+	}
 }
@@ -4,16 +4,27 @@
 #include <limits>
 #include <unordered_map>
 #include <memory>
-#include "Grid.h"
+#include "CowGrid.h"
 #include "../Unit.h"
 #include "Tile.h"
+#include "UnitIndex.h"
+#include "ChangeLog.h"
 #include "../Renderer.h"
 
 class Map {
 public:
 	Map();
+	Map(Map&&) = default;
 	void set_renderer(Renderer& renderer);
 	void reset(Pos2 size);
+	/// Resets to the given walls and light levels with no units.
+	void reset(const Grid<Tile>& tiles, const Grid<short>& light);
+
+	/// Snapshot sharing all state with this map until either side writes to it. The fork has
+	/// no renderer and its own empty change log; discard it by letting it go out of scope.
+	Map fork() const;
+	/// Replaces this map's state with a snapshot's, keeping the renderer and change log.
+	void restore(const Map& snapshot);
 
 	inline Pos2 get_size() const {
 		return grid.get_size();
@@ -33,51 +44,81 @@ public:
 		return grid.get(pos);
 	}
 
+	inline const CowGrid<Tile>& get_tiles() const {
+		return grid;
+	}
+
 	inline bool has_cover(Pos2 pos, Dir dir) const {
 		return get_wall(pos, dir) != Wall::None;
 	}
 
-	Wall& get_wall(Pos2 pos, Dir dir);
 	void set_wall(Pos2 pos, Dir dir, Wall wall);
 	Wall get_wall(Pos2 pos, Dir dir) const;
 
-	inline const std::vector<std::unique_ptr<Unit>>& get_units() const {
+	inline const UnitStore& get_units() const {
 		return units;
 	}
 
-	inline std::vector<std::unique_ptr<Unit>>& get_units() {
+	inline UnitStore& get_units() {
 		return units;
 	}
 
-	inline const Unit* get_unit(Pos2 pos) const {
-		return unit_grid.get(pos);
+	inline const Unit get_unit(Pos2 pos) const {
+		return const_cast<UnitStore&>(units).get(unit_grid.get(pos));
 	}
 
-	inline Unit* get_unit(Pos2 pos) {
-		return unit_grid.get(pos);
+	inline Unit get_unit(Pos2 pos) {
+		return units.get(unit_grid.get(pos));
 	}
 
-	Unit& create_unit(const UnitType& type, Side side, Pos2 pos);
-	void move(const Unit& unit, Pos2 pos);
+	inline const Unit get_unit(UnitHandle handle) const {
+		return const_cast<UnitStore&>(units).get(handle);
+	}
 
-	inline void add_light(Pos2 pos) {
-		light_grid[pos]++;
+	inline Unit get_unit(UnitHandle handle) {
+		return units.get(handle);
 	}
-	inline void remove_light(Pos2 pos) {
-		light_grid[pos]--;
+
+	inline const UnitIndex& get_unit_index() const {
+		return unit_index;
 	}
-	inline bool is_lit(Pos2 pos) {
+
+	Unit create_unit(const UnitType& type, Side side, Pos2 pos);
+	void move(const Unit& unit, Pos2 pos);
+	void remove_unit(const Unit& unit);
+
+	void add_light(Pos2 pos);
+	void remove_light(Pos2 pos);
+	inline bool is_lit(Pos2 pos) const {
 		return light_grid[pos] > 0;
 	}
 
+	/// Zobrist hash of the walls, lit tiles and units. O(1); updated by every mutation.
+	inline uint64_t get_hash() const {
+		return hash ^ units.get_hash();
+	}
+
+	inline ChangeLog& get_changes() {
+		return changes;
+	}
+
 private:
+	Wall& wall_ref(Pos2 pos, Dir dir);
+	static uint64_t wall_key(Pos2 pos, Dir dir, Wall wall);
+	static uint64_t light_key(Pos2 pos);
+
+	Map(const Map& other);
+
 	Renderer* renderer = nullptr;
-	Grid<Tile> grid;
+	ChangeLog changes;
+	CowGrid<Tile> grid;
 
-	std::vector<std::unique_ptr<Unit>> units;
-	Grid<Unit*> unit_grid;
+	UnitStore units;
+	CowGrid<UnitHandle> unit_grid;
+	UnitIndex unit_index;
 
-	Grid<short> light_grid;
+	CowGrid<short> light_grid;
+	uint64_t hash = 0;  // walls and lights; units keep their own
 };
 
 
@@ -0,0 +1,165 @@
+#include "MapGen.h"
+#include "../util/Rando.h"
+#include "../util/Parallel.h"
+#include "../util/Profiler.h"
+
+struct GenLight {
+	Pos2 pos;
+	int radius;
+};
+
+struct GenRegion {
+	Pos2 top_left;
+	Pos2 size;
+	std::vector<GenLight> lights;
+};
+
+/// Number of occurrences for an expected (possibly fractional) count.
+int num_expected(Rando& rando, double expected) {
+	int num = (int)expected;
+	if (rando.rand_float() < expected - num) num++;
+	return num;
+}
+
+void set_tile_wall(Grid<Tile>& tiles, Pos2 pos, Dir dir, Wall wall) {
+	if (dir == Dir::North) {
+		tiles.get(pos).north_wall = wall;
+	} else {
+		tiles.get(pos).west_wall = wall;
+	}
+}
+
+Wall draw_rect_line(Grid<Tile>& tiles, Rando& rando, int length, bool dim, Pos2 offset, Dir dir, Wall selection) {
+	for (int i = 0; i < length; i++) {
+		int r = rando.rand(0, 10);
+		if (r == 0) {
+			continue;
+		} else if (r == 1) {
+			selection = (selection == Wall::Cover ? Wall::Blocking : Wall::Cover);
+		}
+
+		int x = dim ? i : 0;
+		int y = dim ? 0 : i;
+		set_tile_wall(tiles, Pos2(x + offset.x, y + offset.y), dir, selection);
+	}
+
+	return selection;
+}
+
+void gen_rect(Grid<Tile>& tiles, Rando& rando, const GenRegion& region, const MapGenSettings& settings) {
+	// the far walls belong to the tiles just past the rect, which must stay inside the region
+	int wid = std::min((int)rando.rand(settings.min_rect, settings.max_rect), region.size.x - 1);
+	int hei = std::min((int)rando.rand(settings.min_rect, settings.max_rect), region.size.y - 1);
+	if (wid <= 0 || hei <= 0) return;
+	Pos2 offset = region.top_left + Pos2(rando.rand(0, region.size.x - wid), rando.rand(0, region.size.y - hei));
+
+	Wall selection = rando.rand(0, 2) ? Wall::Blocking : Wall::Cover;
+
+	draw_rect_line(tiles, rando, wid, true, offset, Dir::North, selection);
+	draw_rect_line(tiles, rando, hei, false, offset, Dir::West, selection);
+	draw_rect_line(tiles, rando, hei, false, Pos2(offset.x + wid, offset.y), Dir::West, selection);
+	draw_rect_line(tiles, rando, wid, true, Pos2(offset.x, offset.y + hei), Dir::North, selection);
+}
+
+void gen_walls(Grid<Tile>& tiles, Rando& rando, const GenRegion& region, const MapGenSettings& settings) {
+	// each tile owns its north and west edge; jump straight from one walled edge to the next
+	double chance = std::min(settings.wall_density * 2, 1.);
+	if (chance <= 0) return;
+	double log_miss = std::log(1 - chance);
+	double num_edges = (double)region.size.x * region.size.y * 2;
+
+	// draw gaps in blocks from parallel lanes, and the kinds of 64 walls from the bits of one value
+	RandoLanes lanes(rando);
+	const int BLOCK = 64;
+	double gaps[BLOCK];
+	uint64_t kinds = 0;
+	int next = BLOCK;
+
+	double edge = -1;
+	while (true) {
+		if (next == BLOCK) {
+			lanes.fill_float(gaps, BLOCK);
+			kinds = rando.rand();
+			next = 0;
+		}
+		edge += 1 + (chance < 1 ? std::floor(std::log(1 - gaps[next]) / log_miss) : 0);
+		if (!(edge < num_edges)) break;
+		auto tile = (int)((size_t)edge / 2);
+		Pos2 pos = region.top_left + Pos2(tile % region.size.x, tile / region.size.x);
+		Wall wall = ((kinds >> next) & 1) ? Wall::Blocking : Wall::Cover;
+		set_tile_wall(tiles, pos, ((size_t)edge % 2) ? Dir::West : Dir::North, wall);
+		next++;
+	}
+}
+
+void gen_region(Grid<Tile>& tiles, GenRegion& region, Rando& rando, const MapGenSettings& settings) {
+	double area = (double)region.size.x * region.size.y;
+
+	int num_rects = num_expected(rando, settings.rect_density * area);
+	for (int i = 0; i < num_rects; i++) {
+		gen_rect(tiles, rando, region, settings);
+	}
+
+	int num_lights = num_expected(rando, settings.light_density * area);
+	for (int i = 0; i < num_lights; i++) {
+		Pos2 pos = region.top_left + Pos2(rando.rand(0, region.size.x), rando.rand(0, region.size.y));
+		region.lights.push_back(GenLight { pos, (int)rando.rand(settings.min_light, settings.max_light) });
+	}
+
+	gen_walls(tiles, rando, region, settings);
+}
+
+void light_region(Grid<short>& light, const GenRegion& region, const GenLight& source) {
+	Pos2 region_end = region.top_left + region.size;
+	for (int y = std::max(source.pos.y - source.radius, region.top_left.y); y <= source.pos.y + source.radius && y < region_end.y; y++) {
+		for (int x = std::max(source.pos.x - source.radius, region.top_left.x); x <= source.pos.x + source.radius && x < region_end.x; x++) {
+			if ((source.pos - Pos2(x, y)).sqr_length() < source.radius * source.radius) {
+				light.get(Pos2(x, y))++;
+			}
+		}
+	}
+}
+
+void MapGen::generate(Map& map, uint64_t seed, const MapGenSettings& settings) {
+	PROFILE("mapgen");
+	Pos2 size = settings.size;
+	Grid<Tile> tiles(size);
+	Grid<short> light(size, 0);
+
+	int region_size = std::max(settings.region_size, 1);
+	Pos2 num_regions = (size + Pos2(region_size - 1)) / Pos2(region_size);
+	std::vector<GenRegion> regions((size_t)num_regions.x * num_regions.y);
+	for (int y = 0; y < num_regions.y; y++) {
+		for (int x = 0; x < num_regions.x; x++) {
+			GenRegion& region = regions[Pos2(x, y).idx(num_regions.x)];
+			region.top_left = Pos2(x, y) * region_size;
+			region.size = (region.top_left + Pos2(region_size)).min(size) - region.top_left;
+		}
+	}
+
+	std::vector<Rando> streams;
+	Rando rando(seed);
+	for (size_t i = 0; i < regions.size(); i++) {
+		streams.push_back(rando.split());
+	}
+
+	parallel_for(regions.size(), [&](size_t i) {
+		gen_region(tiles, regions[i], streams[i], settings);
+	}, settings.threads);
+
+	// lights can spill into neighbouring regions, so each region collects every light that reaches it
+	int reach = (settings.max_light + region_size - 1) / region_size;
+	parallel_for(regions.size(), [&](size_t i) {
+		Pos2 region_pos((int)i % num_regions.x, (int)i / num_regions.x);
+		for (int y = region_pos.y - reach; y <= region_pos.y + reach; y++) {
+			for (int x = region_pos.x - reach; x <= region_pos.x + reach; x++) {
+				if (x < 0 || y < 0 || x >= num_regions.x || y >= num_regions.y) continue;
+				for (const GenLight& source : regions[Pos2(x, y).idx(num_regions.x)].lights) {
+					light_region(light, regions[i], source);
+				}
+			}
+		}
+	}, settings.threads);
+
+	map.reset(tiles, light);
+}
@@ -0,0 +1,25 @@
+#ifndef SPENCE_MAPGEN_H
+#define SPENCE_MAPGEN_H
+
+#include "Map.h"
+
+struct MapGenSettings {
+	Pos2 size = Pos2(50, 50);
+	int region_size = 32;           // side of the square regions generated independently
+	double rect_density  = 0.0056;  // walled rectangles per tile
+	double light_density = 0.0016;  // light sources per tile
+	double wall_density  = 0.01;    // chance of a random blocking wall per edge (same again for cover)
+	int min_rect  = 2, max_rect  = 12;
+	int min_light = 2, max_light = 6;
+	unsigned threads = 0;           // 0 for one per core
+};
+
+/// Procedural map generation. Regions are generated in parallel, each from its own random
+/// stream split off the seed, so the result only depends on the seed and settings.
+class MapGen {
+public:
+	static void generate(Map& map, uint64_t seed, const MapGenSettings& settings = MapGenSettings());
+};
+
+
+#endif //SPENCE_MAPGEN_H
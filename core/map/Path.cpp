@@ -1,4 +1,5 @@
 #include "Path.h"
+#include "../util/Profiler.h"
 #include <queue>
 #include <algorithm>
 
@@ -13,10 +14,11 @@ int calc_segment(float dist, float radius, int num_segments) {
 }
 
 PathMap Path::calc(const Map& map, Pos2 pos, float radius, PathSettings& settings, int num_segments) {
+	PROFILE("path.calc");
 	radius++;
 	int radius_i = (int)std::ceil(radius);
 	Pos2 top_left = (pos - Pos2(radius_i)).max(Pos2());
-	Pos2 bot_rite = (pos + Pos2(radius_i)).max(map.get_size());
+	Pos2 bot_rite = (pos + Pos2(radius_i + 1)).min(map.get_size());
 	Grid<PathNode> path_grid(bot_rite - top_left, PathNode(), top_left);
 	PathNode& start = path_grid.get(pos);
 	start.pos = pos;
@@ -94,7 +96,7 @@ PathMap Path::calc(const Map& map, Pos2 pos, float radius, PathSettings& setting
 	return PathMap(pos, path_grid);
 }
 
-bool PathMap::can_access(Pos2 pos) {
+bool PathMap::can_access(Pos2 pos) const {
 	if (!grid.in_bounds(pos)) return false;
 	return grid.get(pos).state == PathNode::ACCESSABLE;
 }
@@ -104,7 +106,13 @@ PathNode* PathMap::get_node(Pos2 pos) {
 	return &grid.get(pos);
 }
 
-std::vector<Pos2> Path::to(PathMap& pathmap, Pos2 dest) {
+const PathNode* PathMap::get_node(Pos2 pos) const {
+	if (!grid.in_bounds(pos)) return nullptr;
+	return &grid.get(pos);
+}
+
+std::vector<Pos2> Path::to(const PathMap& pathmap, Pos2 dest) {
+	PROFILE("path.to");
 	if (dest.y == -1) return std::vector<Pos2>(1, dest);
 	Pos2 prev = dest;
 	Pos2 cur = pathmap.grid.get(dest).parent;
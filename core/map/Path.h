@@ -25,8 +25,9 @@ public:
 	PathMap(): grid(Pos2()) { }
 	PathMap(Pos2 source, Grid<PathNode> grid):
 		source(source), grid(std::move(grid)) { }
-	bool can_access(Pos2 pos);
+	bool can_access(Pos2 pos) const;
 	PathNode* get_node(Pos2 pos);
+	const PathNode* get_node(Pos2 pos) const;
 	Pos2 source;
 
 private:
@@ -37,7 +38,7 @@ private:
 class Path {
 public:
 	static PathMap calc(const Map& map, Pos2 pos, float radius, PathSettings& settings, int num_segments = 1);
-	static std::vector<Pos2> to(PathMap& path, Pos2 dest);
+	static std::vector<Pos2> to(const PathMap& path, Pos2 dest);
 	static bool in_line(Pos2 a, Pos2 b, Pos2 c);
 };
 
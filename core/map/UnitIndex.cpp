@@ -0,0 +1,88 @@
+#include "UnitIndex.h"
+#include <algorithm>
+
+UnitIndex::UnitIndex(int bucket_size): bucket_size(bucket_size),
+	sides { Buckets(Pos2()), Buckets(Pos2()), Buckets(Pos2()) } { }
+
+void UnitIndex::reset(Pos2 map_size) {
+	Pos2 num_buckets = (map_size + Pos2(bucket_size - 1)) / Pos2(bucket_size);
+	for (auto& buckets : sides) {
+		buckets = Buckets(num_buckets);
+	}
+}
+
+UnitIndex::Bucket& UnitIndex::bucket(Side side, Pos2 pos) {
+	return sides[(int)side].mut(bucket_of(pos));
+}
+
+void UnitIndex::erase(Bucket& bucket, UnitHandle unit) {
+	auto iter = std::find_if(bucket.begin(), bucket.end(), [&](const Entry& entry) { return entry.unit == unit; });
+	assert(iter != bucket.end());
+	*iter = bucket.back();
+	bucket.pop_back();
+}
+
+void UnitIndex::insert(UnitHandle unit, Side side, Pos2 pos) {
+	bucket(side, pos).push_back(Entry { unit, pos });
+}
+
+void UnitIndex::move(UnitHandle unit, Side side, Pos2 from, Pos2 to) {
+	if (bucket_of(from) == bucket_of(to)) {
+		for (Entry& entry : bucket(side, from)) {
+			if (entry.unit == unit) entry.pos = to;
+		}
+		return;
+	}
+	erase(bucket(side, from), unit);
+	insert(unit, side, to);
+}
+
+void UnitIndex::remove(UnitHandle unit, Side side, Pos2 pos) {
+	erase(bucket(side, pos), unit);
+}
+
+std::vector<UnitHandle> UnitIndex::in_range(Side side, Pos2 pos, double radius) const {
+	std::vector<UnitHandle> res;
+	for_each_in_range(side, pos, radius, [&](UnitHandle unit, Pos2) { res.push_back(unit); });
+	return res;
+}
+
+std::vector<UnitHandle> UnitIndex::nearest(Side side, Pos2 pos, size_t k) const {
+	const Buckets& buckets = sides[(int)side];
+	std::vector<std::pair<int, UnitHandle>> found;
+	if (k == 0) return {};
+
+	// search rings of buckets outward until nothing unvisited can be closer than the kth found
+	Pos2 center = bucket_of(pos);
+	Pos2 num_buckets = buckets.get_size();
+	int max_ring = std::max(std::max(center.x, num_buckets.x - center.x), std::max(center.y, num_buckets.y - center.y));
+	for (int ring = 0; ring <= max_ring; ring++) {
+		for (int y = center.y - ring; y <= center.y + ring; y++) {
+			int step = (y == center.y - ring || y == center.y + ring) ? 1 : ring * 2;
+			for (int x = center.x - ring; x <= center.x + ring; x += step) {
+				if (!buckets.in_bounds(Pos2(x, y))) continue;
+				for (const Entry& entry : buckets.get(Pos2(x, y))) {
+					found.emplace_back((entry.pos - pos).sqr_length(), entry.unit);
+				}
+			}
+		}
+
+		if (found.size() >= k) {
+			std::nth_element(found.begin(), found.begin() + (k - 1), found.end(),
+			                 [](auto& a, auto& b) { return a.first < b.first; });
+			int reach = ring * bucket_size;
+			if (found[k - 1].first <= reach * reach) break;
+		}
+	}
+
+	std::sort(found.begin(), found.end(), [](auto& a, auto& b) { return a.first < b.first; });
+	std::vector<UnitHandle> res;
+	for (size_t i = 0; i < found.size() && i < k; i++) {
+		res.push_back(found[i].second);
+	}
+	return res;
+}
+
+std::vector<UnitHandle> UnitIndex::in_weapon_range(Side side, const Unit& unit, const Weapon& weapon) const {
+	return in_range(side, unit.pos(), weapon.max_range(unit.type().accuracy()));
+}
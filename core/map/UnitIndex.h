@@ -0,0 +1,78 @@
+#ifndef SPENCE_UNITINDEX_H
+#define SPENCE_UNITINDEX_H
+
+#include <array>
+#include <vector>
+#include "CowGrid.h"
+#include "../Unit.h"
+
+/// Uniform bucket grid over unit positions, one per Side, for proximity queries. Buckets are
+/// copy-on-write so a copied index only duplicates the regions it is changed in.
+class UnitIndex {
+public:
+	explicit UnitIndex(int bucket_size = 8);
+	void reset(Pos2 map_size);
+
+	void insert(UnitHandle unit, Side side, Pos2 pos);
+	void move(UnitHandle unit, Side side, Pos2 from, Pos2 to);
+	void remove(UnitHandle unit, Side side, Pos2 pos);
+
+	/// All units of the side within radius of pos.
+	std::vector<UnitHandle> in_range(Side side, Pos2 pos, double radius) const;
+	/// Up to k units of the side nearest to pos, closest first.
+	std::vector<UnitHandle> nearest(Side side, Pos2 pos, size_t k) const;
+	/// Units of the side close enough to the unit to be hit by the weapon.
+	std::vector<UnitHandle> in_weapon_range(Side side, const Unit& unit, const Weapon& weapon) const;
+
+	/// Calls fn(handle, pos) for each unit of the side within radius of pos.
+	template<typename F>
+	void for_each_in_range(Side side, Pos2 pos, double radius, F fn) const {
+		const Buckets& buckets = sides[(int)side];
+		double sqr_radius = radius * radius;
+		Pos2 from = bucket_of(pos - Pos2((int)std::ceil(radius))).max(Pos2());
+		Pos2 to = bucket_of(pos + Pos2((int)std::ceil(radius))).min(buckets.get_size() - Pos2(1));
+		for (int y = from.y; y <= to.y; y++) {
+			for (int x = from.x; x <= to.x; x++) {
+				for (const Entry& entry : buckets.get(Pos2(x, y))) {
+					if ((entry.pos - pos).sqr_length() <= sqr_radius) fn(entry.unit, entry.pos);
+				}
+			}
+		}
+	}
+
+	/// Calls fn(handle, pos) for each unit of the side with top_left <= pos < bot_rite.
+	template<typename F>
+	void for_each_in_rect(Side side, Pos2 top_left, Pos2 bot_rite, F fn) const {
+		const Buckets& buckets = sides[(int)side];
+		Pos2 from = bucket_of(top_left).max(Pos2());
+		Pos2 to = bucket_of(bot_rite - Pos2(1)).min(buckets.get_size() - Pos2(1));
+		for (int y = from.y; y <= to.y; y++) {
+			for (int x = from.x; x <= to.x; x++) {
+				for (const Entry& entry : buckets.get(Pos2(x, y))) {
+					if (entry.pos.x >= top_left.x && entry.pos.y >= top_left.y &&
+					    entry.pos.x < bot_rite.x && entry.pos.y < bot_rite.y) fn(entry.unit, entry.pos);
+				}
+			}
+		}
+	}
+
+private:
+	struct Entry {
+		UnitHandle unit;
+		Pos2 pos;
+	};
+	typedef std::vector<Entry> Bucket;
+	typedef CowGrid<Bucket, 4> Buckets;
+
+	inline Pos2 bucket_of(Pos2 pos) const {
+		return Pos2(pos.x >= 0 ? pos.x / bucket_size : -1, pos.y >= 0 ? pos.y / bucket_size : -1);
+	}
+	Bucket& bucket(Side side, Pos2 pos);
+	void erase(Bucket& bucket, UnitHandle unit);
+
+	int bucket_size;
+	std::array<Buckets, 3> sides;
+};
+
+
+#endif //SPENCE_UNITINDEX_H
@@ -0,0 +1,184 @@
+#include "map/Map.h"
+#include "game/Game.h"
+#include "game/Replay.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "SoftwareRenderer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/// Plays seeded AI-vs-AI games without a window, as fast as the machine allows.
+struct SimOptions {
+	int games = 100;
+	uint64_t seed = 1;
+	unsigned threads = 0;   // games played at once; 0 for one per core
+	double budget_ms = 5;   // AI planning time per turn
+	int max_turns = 100;    // games still going after this many turns are draws
+	Scenario scenario;
+	std::string record;     // if set, each game's action log goes to <record>-<game>.log
+	bool hashes = false;    // store a state hash with each logged action
+	std::string profile_csv;  // if set, the profile is also saved here as CSV
+	Pos2 render_size;       // if set, games are drawn offscreen at this size: replays after every action,
+	                        // new games once at the end
+	std::string frames;     // if set, each game's last frame goes to <frames>-<game>.ppm
+	std::vector<std::string> replays;  // logs to replay instead of playing new games
+};
+
+static void print_usage(const char* name) {
+	std::printf("usage: %s [--games N] [--seed S] [--threads T] [--budget MS] [--max-turns N]\n"
+	            "       %*s [--scenario PRESET|FILE] [--record PREFIX [--hashes]] [--profile-csv FILE]\n"
+	            "       %*s [--render WxH [--frames PREFIX]]\n"
+	            "       %s [--profile-csv FILE] [--render WxH [--frames PREFIX]] --replay LOG...\n",
+	            name, (int)std::strlen(name), "", (int)std::strlen(name), "", name);
+	std::printf("presets:");
+	for (const std::string& preset : Scenario::preset_names()) {
+		std::printf(" %s", preset.c_str());
+	}
+	std::printf("\n");
+}
+
+static bool parse_options(int argc, char** argv, SimOptions& options) {
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--hashes") == 0) {
+			options.hashes = true;
+			continue;
+		} else if (std::strcmp(argv[i], "--replay") == 0) {
+			options.replays.assign(argv + i + 1, argv + argc);
+			return !options.replays.empty();
+		}
+		if (i + 1 >= argc) return false;
+		const char* value = argv[++i];
+		if      (std::strcmp(argv[i - 1], "--games")     == 0) options.games = std::atoi(value);
+		else if (std::strcmp(argv[i - 1], "--seed")      == 0) options.seed = std::strtoull(value, nullptr, 10);
+		else if (std::strcmp(argv[i - 1], "--threads")   == 0) options.threads = (unsigned)std::atoi(value);
+		else if (std::strcmp(argv[i - 1], "--budget")    == 0) options.budget_ms = std::atof(value);
+		else if (std::strcmp(argv[i - 1], "--max-turns") == 0) options.max_turns = std::atoi(value);
+		else if (std::strcmp(argv[i - 1], "--record")    == 0) options.record = value;
+		else if (std::strcmp(argv[i - 1], "--profile-csv") == 0) options.profile_csv = value;
+		else if (std::strcmp(argv[i - 1], "--frames")    == 0) options.frames = value;
+		else if (std::strcmp(argv[i - 1], "--render")    == 0) {
+			Pos2& size = options.render_size;
+			if (std::sscanf(value, "%dx%d", &size.x, &size.y) != 2 || size.x <= 0 || size.y <= 0) return false;
+		}
+		else if (std::strcmp(argv[i - 1], "--scenario")  == 0) {
+			if (!Scenario::find(value, options.scenario)) return false;
+		}
+		else return false;
+	}
+	if (!options.frames.empty() && options.render_size.x == 0) return false;
+	return options.games > 0;
+}
+
+static bool rendering(const SimOptions& options) {
+	return options.render_size.x > 0;
+}
+
+static bool print_profile(const SimOptions& options) {
+	std::printf("%-16s %10s %12s %12s %12s\n", "section", "calls", "total ms", "mean us", "p99 us");
+	for (const Profiler::Sample& sample : Profiler::samples()) {
+		std::printf("%-16s %10llu %12.1f %12.1f %12.1f\n", sample.name.c_str(), (unsigned long long)sample.calls,
+		            sample.ns / 1e6, sample.mean_ns() / 1e3, sample.p99_ns / 1e3);
+	}
+	return options.profile_csv.empty() || Profiler::save_csv(options.profile_csv);
+}
+
+static int replay(const SimOptions& options) {
+	int num_diverged = 0;
+	size_t total_actions = 0;
+	double total_ms = 0;
+	for (size_t i = 0; i < options.replays.size(); i++) {
+		const std::string& path = options.replays[i];
+		ActionLog log;
+		if (!log.load(path)) return 1;
+		Map map;
+		SoftwareRenderer renderer(options.render_size, 0, map);
+		ReplayResult result = Replay::run(log, map, rendering(options) ? &renderer : nullptr);
+		if (!options.frames.empty() && !renderer.save_ppm(options.frames + "-" + std::to_string(i) + ".ppm")) return 1;
+		total_actions += result.num_actions;
+		total_ms += result.ms;
+		std::printf("%s: %zu actions in %.1f ms, final hash %016llx", path.c_str(), result.num_actions, result.ms,
+		            (unsigned long long)result.final_hash);
+		if (result.diverged()) {
+			std::printf(", diverged at action %zu\n", result.diverged_at);
+			num_diverged++;
+		} else {
+			std::printf("%s\n", log.has_hashes() ? ", matched" : "");
+		}
+	}
+	std::printf("%zu actions in %.2f s (%.0f actions/sec), %d of %zu logs diverged\n\n",
+	            total_actions, total_ms / 1000, total_ms > 0 ? total_actions * 1000 / total_ms : 0.,
+	            num_diverged, options.replays.size());
+	if (!print_profile(options)) return 1;
+	return num_diverged > 0 ? 2 : 0;
+}
+
+int main(int argc, char** argv) {
+	SimOptions options;
+	if (!parse_options(argc, argv, options)) {
+		print_usage(argv[0]);
+		return 1;
+	}
+	if (!options.replays.empty()) {
+		return replay(options);
+	}
+
+	Rando root(options.seed);
+	std::vector<uint64_t> seeds;
+	for (int i = 0; i < options.games; i++) {
+		seeds.push_back(root.rand());
+	}
+
+	unsigned threads = (unsigned)std::min<size_t>(num_workers(options.threads), seeds.size());
+	std::vector<Side> winners(seeds.size());
+	std::vector<int> turns(seeds.size());
+
+	auto start = std::chrono::steady_clock::now();
+	parallel_for(seeds.size(), [&](size_t i) {
+		Map map;
+		UI ui;
+		Game game(map, ui, seeds[i]);
+		game.set_ai_controlled(Side::You, true);
+		game.set_max_turns(options.max_turns);
+		game.set_scenario(options.scenario);
+
+		// with games already running on every core, nested planner threads would only contend
+		MonteCarloSettings settings = game.get_ai().get_settings();
+		settings.budget_ms = options.budget_ms;
+		settings.utility.budget_ms = options.budget_ms / 2;
+		settings.threads = settings.utility.threads = threads > 1 ? 1 : 0;
+		game.get_ai().set_settings(settings);
+
+		ActionLog log(seeds[i], options.hashes);
+		if (!options.record.empty()) game.set_log(&log);
+		SoftwareRenderer renderer(options.render_size, 0, map);
+		if (rendering(options)) map.set_renderer(renderer);
+
+		game.init();
+		if (rendering(options)) renderer.render();
+		if (!options.frames.empty()) renderer.save_ppm(options.frames + "-" + std::to_string(i) + ".ppm");
+		winners[i] = game.get_winner();
+		turns[i] = game.get_turn_count();
+		if (!options.record.empty()) log.save(options.record + "-" + std::to_string(i) + ".log");
+	}, threads);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int wins[3] = { };
+	long total_turns = 0;
+	for (size_t i = 0; i < seeds.size(); i++) {
+		wins[(int)winners[i]]++;
+		total_turns += turns[i];
+	}
+
+	std::printf("%s: %dx%d, %d vs %d units\n", options.scenario.name.c_str(), options.scenario.gen.size.x,
+	            options.scenario.gen.size.y, options.scenario.num_you, options.scenario.num_enemy);
+	std::printf("%d games in %.2f s (%.2f games/sec) on %u threads\n",
+	            options.games, seconds, options.games / seconds, threads);
+	std::printf("you won %d, enemy won %d, %d drawn; %.1f turns on average\n\n",
+	            wins[(int)Side::You], wins[(int)Side::Enemy], wins[(int)Side::None], (double)total_turns / options.games);
+
+	return print_profile(options) ? 0 : 1;
+}
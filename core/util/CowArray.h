@@ -0,0 +1,114 @@
+#ifndef SPENCE_COWARRAY_H
+#define SPENCE_COWARRAY_H
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+/// Chunked array with copy-on-write sharing. Copying is O(1); the first write through a copy
+/// duplicates the chunk table and then only the chunks that are written to.
+///
+/// Threading: each CowArray object belongs to one thread at a time, but copies may be read and
+/// destroyed on other threads while this one writes, as with map forks handed to the render
+/// thread. A write only reuses memory in place once every other copy has released it, and the
+/// acquire in exclusive() orders that write after the other thread's last reads.
+template<typename T, size_t CHUNK = 64>
+class CowArray {
+public:
+	CowArray(): table(std::make_shared<Table>()) { }
+	CowArray(size_t count, T val): CowArray() {
+		resize(count, val);
+	}
+
+	inline size_t size() const {
+		return count;
+	}
+
+	inline const T& get(size_t i) const {
+		assert(i < count);
+		return (*(*table)[i / CHUNK])[i % CHUNK];
+	}
+	inline const T& operator[](size_t i) const {
+		return get(i);
+	}
+
+	inline T& mut(size_t i) {
+		assert(i < count);
+		if (!exclusive(table)) table = std::make_shared<Table>(*table);
+		std::shared_ptr<Chunk>& chunk = (*table)[i / CHUNK];
+		if (!exclusive(chunk)) chunk = std::make_shared<Chunk>(*chunk);
+		return (*chunk)[i % CHUNK];
+	}
+	inline void set(size_t i, T val) {
+		mut(i) = std::move(val);
+	}
+
+	/// Elements from i to the end of its chunk are contiguous.
+	inline const T* contiguous(size_t i) const {
+		return &get(i);
+	}
+
+	/// Whether chunk c is the same memory in both arrays, so none of its elements can differ.
+	inline bool shares_chunk(const CowArray& other, size_t c) const {
+		return c < table->size() && c < other.table->size() && (*table)[c] == (*other.table)[c];
+	}
+
+	void push_back(T val) {
+		if (count % CHUNK == 0) {
+			if (!exclusive(table)) table = std::make_shared<Table>(*table);
+			table->push_back(std::make_shared<Chunk>());
+		}
+		count++;
+		set(count - 1, std::move(val));
+	}
+
+	void pop_back() {
+		assert(count > 0);
+		count--;
+		if (count % CHUNK == 0) {
+			if (!exclusive(table)) table = std::make_shared<Table>(*table);
+			table->pop_back();
+		}
+	}
+
+	/// New elements are set to val. Whole new chunks share one copy until written.
+	void resize(size_t new_count, T val = T()) {
+		while (count > new_count) pop_back();
+		while (count < new_count && count % CHUNK != 0) push_back(val);
+		if (count == new_count) return;
+
+		if (!exclusive(table)) table = std::make_shared<Table>(*table);
+		auto filled = std::make_shared<Chunk>();
+		filled->fill(val);
+		while (new_count - count >= CHUNK) {
+			table->push_back(filled);
+			count += CHUNK;
+		}
+		while (count < new_count) push_back(val);
+	}
+
+	void clear() {
+		table = std::make_shared<Table>();
+		count = 0;
+	}
+
+private:
+	typedef std::array<T, CHUNK> Chunk;
+	typedef std::vector<std::shared_ptr<Chunk>> Table;
+
+	/// Whether nothing else holds ptr, so it can be written in place. use_count() is a relaxed
+	/// load; the fence pairs it with the release of the last other holder.
+	template<typename U>
+	static inline bool exclusive(const std::shared_ptr<U>& ptr) {
+		if (ptr.use_count() > 1) return false;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return true;
+	}
+
+	std::shared_ptr<Table> table;
+	size_t count = 0;
+};
+
+#endif //SPENCE_COWARRAY_H
@@ -0,0 +1,73 @@
+#include "JobQueue.h"
+
+JobQueue::~JobQueue() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		queued.clear();
+	}
+	wake.notify_all();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void JobQueue::submit(std::function<void()> work, std::function<void()> done) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queued.push_back(Job { std::move(work), std::move(done) });
+		num_pending++;
+		if (threads.empty()) {
+			for (unsigned t = 0; t < std::max(num_threads, 1u); t++) {
+				threads.emplace_back(&JobQueue::run, this);
+			}
+		}
+	}
+	wake.notify_one();
+}
+
+size_t JobQueue::poll() {
+	std::deque<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.swap(completed);
+	}
+	for (auto& done : ready) {
+		if (done) done();
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	num_pending -= ready.size();
+	return ready.size();
+}
+
+void JobQueue::wait() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [this]() { return queued.empty() && num_running == 0; });
+	}
+	poll();
+}
+
+void JobQueue::run() {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !queued.empty(); });
+			if (stopping) return;
+			job = std::move(queued.front());
+			queued.pop_front();
+			num_running++;
+		}
+
+		job.work();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			completed.push_back(std::move(job.done));
+			num_running--;
+		}
+		finished.notify_all();
+	}
+}
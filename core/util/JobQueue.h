@@ -0,0 +1,54 @@
+#ifndef SPENCE_JOBQUEUE_H
+#define SPENCE_JOBQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Runs jobs on background threads. Each job may come with a done callback, which runs on whichever
+/// thread calls poll() once the job has finished, so results are only ever published from there.
+/// Threads are started on the first submit.
+class JobQueue {
+public:
+	explicit JobQueue(unsigned num_threads = 1): num_threads(num_threads) { }
+	~JobQueue();
+	JobQueue(const JobQueue&) = delete;
+	JobQueue& operator=(const JobQueue&) = delete;
+
+	void submit(std::function<void()> work, std::function<void()> done = nullptr);
+
+	/// Runs the done callbacks of finished jobs, in the order they finished. Returns how many ran.
+	size_t poll();
+	/// Blocks until every submitted job has finished, then polls.
+	void wait();
+
+	/// Jobs submitted whose done callbacks haven't been run yet.
+	inline size_t pending() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return num_pending;
+	}
+
+private:
+	struct Job {
+		std::function<void()> work;
+		std::function<void()> done;
+	};
+
+	void run();
+
+	unsigned num_threads;
+	std::vector<std::thread> threads;
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	std::deque<Job> queued;
+	std::deque<std::function<void()>> completed;
+	size_t num_pending = 0;
+	size_t num_running = 0;
+	bool stopping = false;
+};
+
+#endif //SPENCE_JOBQUEUE_H
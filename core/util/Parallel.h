@@ -0,0 +1,38 @@
+#ifndef SPENCE_PARALLEL_H
+#define SPENCE_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+inline unsigned num_workers(unsigned requested = 0) {
+	if (requested > 0) return requested;
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+/// Calls fn(i) for every i in [0, count) spread over up to num_threads threads (0 for one per core).
+/// Returns once all calls have finished.
+template<typename F>
+void parallel_for(size_t count, F fn, unsigned num_threads = 0) {
+	num_threads = (unsigned)std::min<size_t>(num_workers(num_threads), count);
+	if (num_threads <= 1) {
+		for (size_t i = 0; i < count; i++) fn(i);
+		return;
+	}
+
+	std::atomic<size_t> next(0);
+	auto work = [&]() {
+		for (size_t i = next++; i < count; i = next++) fn(i);
+	};
+	std::vector<std::thread> threads;
+	for (unsigned t = 1; t < num_threads; t++) {
+		threads.emplace_back(work);
+	}
+	work();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+#endif //SPENCE_PARALLEL_H
@@ -0,0 +1,77 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+static std::mutex& sections_mutex() {
+	static std::mutex mutex;
+	return mutex;
+}
+
+static std::deque<Profiler::Section>& sections() {
+	static std::deque<Profiler::Section> sections;
+	return sections;
+}
+
+Profiler::Section& Profiler::section(const char* name) {
+	std::lock_guard<std::mutex> lock(sections_mutex());
+	for (Section& section : sections()) {
+		if (std::strcmp(section.name, name) == 0) return section;
+	}
+	sections().emplace_back(name);
+	return sections().back();
+}
+
+uint64_t Profiler::Section::bucket_max(size_t bucket) {
+	if (bucket < 4) return bucket;
+	int log = (int)(bucket / 4) + 1;
+	return ((4 + bucket % 4 + 1) << (log - 2)) - 1;
+}
+
+std::vector<Profiler::Sample> Profiler::samples() {
+	std::lock_guard<std::mutex> lock(sections_mutex());
+	std::vector<Sample> samples;
+	for (const Section& section : sections()) {
+		uint64_t calls = section.calls;
+		uint64_t p99 = 0;
+		uint64_t seen = 0;
+		for (size_t b = 0; b < Section::NUM_BUCKETS && calls > 0; b++) {
+			seen += section.buckets[b];
+			if (seen * 100 >= calls * 99) {
+				p99 = std::min<uint64_t>(Section::bucket_max(b), section.max_ns);
+				break;
+			}
+		}
+		samples.push_back(Sample { section.name, section.ns, calls, calls > 0 ? (uint64_t)section.min_ns : 0,
+		                           section.max_ns, p99 });
+	}
+	return samples;
+}
+
+void Profiler::reset() {
+	std::lock_guard<std::mutex> lock(sections_mutex());
+	for (Section& section : sections()) {
+		section.ns = 0;
+		section.calls = 0;
+		section.min_ns = UINT64_MAX;
+		section.max_ns = 0;
+		for (auto& bucket : section.buckets) bucket = 0;
+	}
+}
+
+bool Profiler::save_csv(const std::string& path) {
+	std::ofstream file(path);
+	file << "section,calls,total_us,min_us,mean_us,p99_us,max_us\n";
+	for (const Sample& sample : samples()) {
+		file << sample.name << ',' << sample.calls << ',' << sample.ns / 1e3 << ',' << sample.min_ns / 1e3 << ','
+		     << sample.mean_ns() / 1e3 << ',' << sample.p99_ns / 1e3 << ',' << sample.max_ns / 1e3 << '\n';
+	}
+	if (!file) {
+		std::cout << "Couldn't write profile " << path << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,98 @@
+#ifndef SPENCE_PROFILER_H
+#define SPENCE_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Wall time spent in named sections of code, summed over all threads. Times are inclusive, so
+/// a section nested in another is counted in both.
+class Profiler {
+public:
+	struct Section {
+		/// Call times are also counted in buckets four to a power of two, which puts percentiles
+		/// within 25% of the real value.
+		static const size_t NUM_BUCKETS = 256;
+
+		explicit Section(const char* name): name(name) {
+			for (auto& bucket : buckets) bucket = 0;
+		}
+
+		inline void add(uint64_t call_ns) {
+			ns += call_ns;
+			calls++;
+			buckets[bucket_of(call_ns)]++;
+			uint64_t prev = min_ns;
+			while (call_ns < prev && !min_ns.compare_exchange_weak(prev, call_ns)) { }
+			prev = max_ns;
+			while (call_ns > prev && !max_ns.compare_exchange_weak(prev, call_ns)) { }
+		}
+
+		static inline size_t bucket_of(uint64_t ns) {
+			if (ns < 4) return (size_t)ns;
+#if defined(__GNUC__)
+			int log = 63 - __builtin_clzll(ns);
+#else
+			int log = 0;
+			while ((ns >> log) > 1) log++;
+#endif
+			return (size_t)(log - 1) * 4 + ((ns >> (log - 2)) & 3);
+		}
+		/// Largest time that falls in the bucket.
+		static uint64_t bucket_max(size_t bucket);
+
+		const char* name;
+		std::atomic<uint64_t> ns { 0 };
+		std::atomic<uint64_t> calls { 0 };
+		std::atomic<uint64_t> min_ns { UINT64_MAX };
+		std::atomic<uint64_t> max_ns { 0 };
+		std::atomic<uint64_t> buckets[NUM_BUCKETS];
+	};
+
+	struct Sample {
+		std::string name;
+		uint64_t ns;
+		uint64_t calls;
+		uint64_t min_ns;
+		uint64_t max_ns;
+		uint64_t p99_ns;  // upper bound of the bucket the 99th percentile call falls in
+
+		inline double mean_ns() const {
+			return calls > 0 ? (double)ns / calls : 0;
+		}
+	};
+
+	/// Section with the given name, created on first use. The reference stays valid forever.
+	static Section& section(const char* name);
+
+	/// Totals for every section, in the order they were first used.
+	static std::vector<Sample> samples();
+	static void reset();
+	/// Writes samples() as CSV with times in microseconds. Returns false if the file couldn't be written.
+	static bool save_csv(const std::string& path);
+};
+
+class ProfileScope {
+public:
+	explicit ProfileScope(Profiler::Section& section):
+		section(section), start(std::chrono::steady_clock::now()) { }
+	~ProfileScope() {
+		auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		section.add((uint64_t)ns.count());
+	}
+
+private:
+	Profiler::Section& section;
+	std::chrono::steady_clock::time_point start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+/// Times the rest of the enclosing scope under the given section name.
+#define PROFILE(name) \
+	static Profiler::Section& PROFILE_CONCAT(profile_section_, __LINE__) = Profiler::section(name); \
+	ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(PROFILE_CONCAT(profile_section_, __LINE__))
+
+#endif //SPENCE_PROFILER_H
@@ -1,4 +1,7 @@
 #include "Rando.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <limits>
 
 Rando::Rando(uint64_t seed) {
@@ -14,6 +17,24 @@ uint64_t rotl(uint64_t x, int k) {
 	return (x << k) | (x >> (64 - k));
 }
 
+/// Full 128 bit product of a and b, as high and low words.
+uint64_t mul_128(uint64_t a, uint64_t b, uint64_t& low) {
+#ifdef __SIZEOF_INT128__
+	__uint128_t product = (__uint128_t)a * b;
+	low = (uint64_t)product;
+	return (uint64_t)(product >> 64);
+#else
+	uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+	uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+	uint64_t lo_lo = a_lo * b_lo;
+	uint64_t hi_lo = a_hi * b_lo;
+	uint64_t lo_hi = a_lo * b_hi;
+	uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+	low = (cross << 32) | (uint32_t)lo_lo;
+	return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+}
+
 uint64_t Rando::rand() {
 	const uint64_t result_starstar = rotl(s[1] * 5, 7) * 9;
 
@@ -32,11 +53,100 @@ uint64_t Rando::rand() {
 }
 
 int64_t Rando::rand(int64_t min, int64_t max) {
-	return rand() % (max - min) + min;
+	// Lemire's multiply-shift: the high word of rand() * range is uniform in [0, range) once the
+	// few low words that would bias it are rejected, which needs a division only on that rare path
+	uint64_t range = (uint64_t)max - (uint64_t)min;
+	uint64_t low;
+	uint64_t high = mul_128(rand(), range, low);
+	if (low < range) {
+		uint64_t threshold = (0 - range) % range;
+		while (low < threshold) {
+			high = mul_128(rand(), range, low);
+		}
+	}
+	return (int64_t)((uint64_t)min + high);
 }
 
 double Rando::rand_float() {
-	return (double)rand() / max();
+	return (double)(rand() >> 11) * (1. / (double)(1ull << 53));
+}
+
+void Rando::fill(uint64_t* dest, size_t count) {
+	uint64_t s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
+	for (size_t i = 0; i < count; i++) {
+		dest[i] = rotl(s1 * 5, 7) * 9;
+		const uint64_t t = s1 << 17;
+		s2 ^= s0;
+		s3 ^= s1;
+		s1 ^= s2;
+		s0 ^= s3;
+		s2 ^= t;
+		s3 = rotl(s3, 45);
+	}
+	s[0] = s0;
+	s[1] = s1;
+	s[2] = s2;
+	s[3] = s3;
+}
+
+void Rando::fill(int64_t* dest, size_t count, int64_t min, int64_t max) {
+	// raw draws in one pass, then mapped in place with one division for the whole batch
+	uint64_t* raw = reinterpret_cast<uint64_t*>(dest);
+	fill(raw, count);
+	uint64_t range = (uint64_t)max - (uint64_t)min;
+	uint64_t threshold = range > 0 ? (0 - range) % range : 0;
+	for (size_t i = 0; i < count; i++) {
+		uint64_t low;
+		uint64_t high = mul_128(raw[i], range, low);
+		dest[i] = low < threshold ? rand(min, max) : (int64_t)((uint64_t)min + high);
+	}
+}
+
+void Rando::fill_float(double* dest, size_t count) {
+	const size_t BLOCK = 64;
+	uint64_t raw[BLOCK];
+	for (size_t i = 0; i < count; i += BLOCK) {
+		size_t n = std::min(BLOCK, count - i);
+		fill(raw, n);
+		for (size_t j = 0; j < n; j++) {
+			dest[i + j] = (double)(raw[j] >> 11) * (1. / (double)(1ull << 53));
+		}
+	}
+}
+
+void Rando::jump(const uint64_t (&poly)[4]) {
+	uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	for (uint64_t word : poly) {
+		for (int b = 0; b < 64; b++) {
+			if (word & (1ull << b)) {
+				s0 ^= s[0];
+				s1 ^= s[1];
+				s2 ^= s[2];
+				s3 ^= s[3];
+			}
+			rand();
+		}
+	}
+	s[0] = s0;
+	s[1] = s1;
+	s[2] = s2;
+	s[3] = s3;
+}
+
+void Rando::jump() {
+	static const uint64_t JUMP[4] = { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+	jump(JUMP);
+}
+
+void Rando::long_jump() {
+	static const uint64_t LONG_JUMP[4] = { 0x76e15d3efefdcbbf, 0xc5004e441c522fb3, 0x77710069854ee241, 0x39109bb02acbe635 };
+	jump(LONG_JUMP);
+}
+
+Rando Rando::split() {
+	Rando stream = *this;
+	jump();
+	return stream;
 }
 
 uint64_t Rando::min() {
@@ -46,3 +156,75 @@ uint64_t Rando::min() {
 uint64_t Rando::max() {
 	return std::numeric_limits<uint64_t>::max();
 }
+
+RandoLanes::RandoLanes(Rando& source) {
+	for (size_t i = 0; i < LANES; i++) {
+		Rando stream = source.split();
+		for (int j = 0; j < 4; j++) {
+			s[j][i] = stream.s[j];
+		}
+	}
+}
+
+void RandoLanes::fill(uint64_t* dest, size_t count) {
+	assert(count % LANES == 0);
+#if defined(__GNUC__)
+	// one state word of every lane per vector; multiplications by 5 and 9 are written as
+	// shift-adds since there's no 64 bit lane multiply before AVX-512
+	typedef uint64_t Lanes __attribute__((vector_size(LANES * sizeof(uint64_t))));
+	Lanes s0, s1, s2, s3;
+	std::memcpy(&s0, s[0], sizeof(Lanes));
+	std::memcpy(&s1, s[1], sizeof(Lanes));
+	std::memcpy(&s2, s[2], sizeof(Lanes));
+	std::memcpy(&s3, s[3], sizeof(Lanes));
+	for (size_t k = 0; k < count; k += LANES) {
+		Lanes x = (s1 << 2) + s1;
+		x = (x << 7) | (x >> 57);
+		x = (x << 3) + x;
+		std::memcpy(dest + k, &x, sizeof(x));
+
+		Lanes t = s1 << 17;
+		s2 ^= s0;
+		s3 ^= s1;
+		s1 ^= s2;
+		s0 ^= s3;
+		s2 ^= t;
+		s3 = (s3 << 45) | (s3 >> 19);
+	}
+	std::memcpy(s[0], &s0, sizeof(Lanes));
+	std::memcpy(s[1], &s1, sizeof(Lanes));
+	std::memcpy(s[2], &s2, sizeof(Lanes));
+	std::memcpy(s[3], &s3, sizeof(Lanes));
+#else
+	for (size_t i = 0; i < LANES; i++) {
+		Rando stream = lane(i);
+		for (size_t k = 0; k < count; k += LANES) {
+			dest[k + i] = stream.rand();
+		}
+		for (int j = 0; j < 4; j++) {
+			s[j][i] = stream.s[j];
+		}
+	}
+#endif
+}
+
+void RandoLanes::fill_float(double* dest, size_t count) {
+	assert(count % LANES == 0);
+	const size_t BLOCK = 64;
+	uint64_t raw[BLOCK];
+	for (size_t i = 0; i < count; i += BLOCK) {
+		size_t n = std::min(BLOCK, count - i);
+		fill(raw, n);
+		for (size_t j = 0; j < n; j++) {
+			dest[i + j] = (double)(raw[j] >> 11) * (1. / (double)(1ull << 53));
+		}
+	}
+}
+
+Rando RandoLanes::lane(size_t i) const {
+	Rando stream(0);
+	for (int j = 0; j < 4; j++) {
+		stream.s[j] = s[j][i];
+	}
+	return stream;
+}
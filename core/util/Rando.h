@@ -1,6 +1,7 @@
 #ifndef SPENCE_RANDO_H
 #define SPENCE_RANDO_H
 
+#include <cstddef>
 #include <cstdint>
 
 class Rando {
@@ -9,7 +10,22 @@ public:
 
 	uint64_t rand();
 	int64_t rand(int64_t min, int64_t max); // [min, max)
-	double rand_float();
+	double rand_float();                    // [0, 1)
+
+	/// Bulk versions of the above. The raw and float fills give the same values as count single
+	/// calls. The bounded fill is just as uniform, but redraws its rare rejected values after the
+	/// batch rather than in place, so its sequence differs from single calls.
+	void fill(uint64_t* dest, size_t count);
+	void fill(int64_t* dest, size_t count, int64_t min, int64_t max);
+	void fill_float(double* dest, size_t count);
+
+	/// Advances 2^128 draws; gives 2^128 non-overlapping streams for parallel use.
+	void jump();
+	/// Advances 2^192 draws; gives 2^64 starting points that can each be split with jump().
+	void long_jump();
+	/// Returns a copy of this generator and jumps this one past it, so repeated calls hand out
+	/// non-overlapping streams (e.g. one per worker thread) in a reproducible order.
+	Rando split();
 
 	uint64_t static min();
 	uint64_t static max();
@@ -18,7 +34,32 @@ public:
 	}
 
 private:
+	void jump(const uint64_t (&poly)[4]);
+
 	uint64_t s[4];
+
+	friend class RandoLanes;
+};
+
+/// Several xoshiro256** streams stepped together. The state is stored word by word across lanes,
+/// so the fill loops vectorise with each state word of every lane in one SIMD register. Lane i
+/// produces exactly the values the ith split() of the source generator would.
+class RandoLanes {
+public:
+	static const size_t LANES = 4;
+
+	explicit RandoLanes(Rando& source);
+
+	/// Writes count / LANES draws from every lane, interleaved: dest[k * LANES + i] is the kth draw
+	/// of lane i. count must be a multiple of LANES.
+	void fill(uint64_t* dest, size_t count);
+	/// As fill(), with each draw converted like Rando::rand_float().
+	void fill_float(double* dest, size_t count);
+	/// Scalar generator continuing lane i.
+	Rando lane(size_t i) const;
+
+private:
+	uint64_t s[4][LANES];
 };
 
 #endif //SPENCE_RANDO_H
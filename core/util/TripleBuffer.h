@@ -0,0 +1,46 @@
+#ifndef SPENCE_TRIPLEBUFFER_H
+#define SPENCE_TRIPLEBUFFER_H
+
+#include <atomic>
+
+/// Hands the latest value from one writer thread to one reader thread without locks. The writer
+/// fills write_slot() and publishes it; the reader takes the newest published value with update()
+/// and reads read_slot() until its next update. Neither side ever waits for the other, and values
+/// published while the reader was busy are skipped.
+template<typename T>
+class TripleBuffer {
+public:
+	/// Slot only the writer touches. Holds whatever was published two or three values ago.
+	inline T& write_slot() {
+		return slots[write];
+	}
+
+	/// Makes the write slot the newest value and gives the writer the spare slot.
+	inline void publish() {
+		write = middle.exchange(write | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	/// Swaps in the newest value if one was published since the last call. Returns whether it did.
+	inline bool update() {
+		if (!(middle.load(std::memory_order_acquire) & FRESH)) return false;
+		read = middle.exchange(read, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+
+	/// Slot only the reader touches; default constructed until the first update().
+	inline const T& read_slot() const {
+		return slots[read];
+	}
+
+private:
+	static const int INDEX = 3;
+	static const int FRESH = 4;  // set while the middle slot hasn't been read
+
+	T slots[3];
+	std::atomic<int> middle { 1 };
+	int write = 0;
+	int read = 2;
+};
+
+
+#endif //SPENCE_TRIPLEBUFFER_H
@@ -0,0 +1,39 @@
+#ifndef SPENCE_ZOBRIST_H
+#define SPENCE_ZOBRIST_H
+
+#include <cstdint>
+#include "Vec.h"
+
+/// Keys for incremental state hashing. A state hashes to the xor of the keys of its features, so
+/// changing one feature costs two xors: the old key out and the new one in. Keys are mixed from
+/// the feature itself rather than looked up in a random table, so any map size or unit count works
+/// and every process agrees on them.
+class Zobrist {
+public:
+	enum class Feature : uint8_t {
+		Wall,
+		Light,
+		Unit,
+		Turn,
+	};
+
+	static inline uint64_t key(Feature feature, uint64_t where, uint64_t value = 0) {
+		return mix(mix(where ^ ((uint64_t)feature << 56)) ^ value);
+	}
+
+	static inline uint64_t pack(Pos2 pos) {
+		return ((uint64_t)(uint32_t)pos.x << 32) | (uint32_t)pos.y;
+	}
+
+private:
+	// splitmix64 finaliser
+	static inline uint64_t mix(uint64_t z) {
+		z += 0x9e3779b97f4a7c15ull;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+};
+
+
+#endif //SPENCE_ZOBRIST_H
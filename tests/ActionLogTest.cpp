@@ -0,0 +1,123 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "Check.h"
+#include "game/ActionLog.h"
+#include "game/Game.h"
+#include "game/Replay.h"
+
+static const char* PATH = "ActionLogTest.log";
+
+static Action make_action(Action::Type type, UnitHandle unit, Pos2 pos, int segment = 0) {
+	Action action(type);
+	action.unit = unit;
+	action.pos = pos;
+	action.segment = segment;
+	return action;
+}
+
+static bool same_records(const ActionLog& a, const ActionLog& b) {
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		const ActionLog::Record& ra = a[i];
+		const ActionLog::Record& rb = b[i];
+		if (ra.type != rb.type || ra.hash != rb.hash) return false;
+		if (ra.type == Action::Type::EndTurn) continue;
+		if (ra.unit != rb.unit || ra.pos != rb.pos) return false;
+		if (ra.type == Action::Type::Move ? ra.segment != rb.segment : ra.weapon != rb.weapon) return false;
+	}
+	return true;
+}
+
+static std::string read_file(const char* path) {
+	std::ifstream file(path, std::ios::binary);
+	return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const char* path, const std::string& data) {
+	std::ofstream file(path, std::ios::binary);
+	file.write(data.data(), data.size());
+}
+
+static void test_round_trip() {
+	// every action kind, with negative zigzags and varints needing all ten bytes or close to it
+	ActionLog log(0xfedcba9876543210ull, true);
+	log.set_scenario("preset = large\nenemies = 7\n");
+	log.add(make_action(Action::Type::Move, UnitHandle(0, 0), Pos2(3, 4), 2), 0, 1);
+	log.add(make_action(Action::Type::Move, UnitHandle(0xfffffffe, 0xffffffff), Pos2(-1, -2147483647 - 1), -3), 0,
+	        0xffffffffffffffffull);
+	log.add(make_action(Action::Type::Attack, UnitHandle(127, 128), Pos2(2147483647, -64)), 3, 0x8000000000000000ull);
+	log.add(make_action(Action::Type::None, UnitHandle(16384, 1), Pos2(0, 0)), 0, 42);
+	log.add(Action(Action::Type::EndTurn), 0, 7);
+
+	CHECK(log.save(PATH));
+	ActionLog loaded;
+	CHECK(loaded.load(PATH));
+	CHECK(loaded.get_seed() == log.get_seed());
+	CHECK(loaded.has_hashes());
+	CHECK(loaded.get_scenario() == log.get_scenario());
+	CHECK(same_records(log, loaded));
+
+	// without hashes the records come back with none
+	ActionLog unhashed(5, false);
+	unhashed.add(make_action(Action::Type::Move, UnitHandle(1, 2), Pos2(-5, 6), 1), 0);
+	CHECK(unhashed.save(PATH));
+	CHECK(loaded.load(PATH));
+	CHECK(!loaded.has_hashes());
+	CHECK(loaded.get_scenario().empty());
+	CHECK(same_records(unhashed, loaded));
+
+	// another format version, truncation and a foreign file are all rejected
+	CHECK(log.save(PATH));
+	std::string data = read_file(PATH);
+	std::string bad_version = data;
+	bad_version[4] = (char)(bad_version[4] + 1);
+	write_file(PATH, bad_version);
+	CHECK(!loaded.load(PATH));
+	write_file(PATH, data.substr(0, data.size() - 3));
+	CHECK(!loaded.load(PATH));
+	write_file(PATH, "not a log");
+	CHECK(!loaded.load(PATH));
+	CHECK(!loaded.load("missing/ActionLogTest.log"));
+}
+
+static void test_replay() {
+	// an AI vs AI game recorded with hashes replays to the same state after every action
+	Map map;
+	UI ui;
+	Game game(map, ui, 17);
+	game.set_ai_controlled(Side::You, true);
+	game.set_max_turns(12);
+	MonteCarloSettings settings = game.get_ai().get_settings();
+	settings.budget_ms = 4;
+	settings.utility.budget_ms = 2;
+	game.get_ai().set_settings(settings);
+	ActionLog log(17, true);
+	game.set_log(&log);
+	game.init();
+	CHECK(log.size() > 0);
+
+	CHECK(log.save(PATH));
+	ActionLog loaded;
+	CHECK(loaded.load(PATH));
+	ReplayResult result = Replay::run(loaded);
+	CHECK(!result.diverged());
+	CHECK(result.num_actions == log.size());
+	CHECK(Replay::run(loaded).final_hash == result.final_hash);
+
+	// a changed hash shows up at the action it belongs to
+	std::string data = read_file(PATH);
+	data[data.size() - 1] ^= 1;
+	write_file(PATH, data);
+	CHECK(loaded.load(PATH));
+	result = Replay::run(loaded);
+	CHECK(result.diverged_at == log.size() - 1);
+}
+
+int main() {
+	test_round_trip();
+	test_replay();
+	std::remove(PATH);
+	return test_result();
+}
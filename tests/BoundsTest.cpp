@@ -0,0 +1,46 @@
+#include "Check.h"
+#include "Fov.h"
+#include "Path.h"
+
+int main() {
+	Map map;
+	map.reset(Pos2(20, 20));
+	const int radius = 3;
+
+	// FOV covers exactly radius tiles each way, including the far row and column
+	Grid<char> fov = Fov::calc(map, Pos2(8, 8), radius);
+	CHECK(fov.get_offset() == Pos2(8 - radius));
+	CHECK(fov.get_size() == Pos2(radius * 2 + 1));
+	CHECK(fov.get(Pos2(8 + radius, 8)) != 0);
+	CHECK(fov.get(Pos2(8, 8 + radius)) != 0);
+	CHECK(fov.get(Pos2(8 - radius, 8)) != 0);
+
+	// and is clamped to the map at its corners rather than stretching to the far side
+	fov = Fov::calc(map, Pos2(19, 19), radius);
+	CHECK(fov.get_offset() == Pos2(19 - radius));
+	CHECK(fov.get_size() == Pos2(radius + 1));
+	CHECK(fov.get(Pos2(19, 19 - radius)) != 0);
+	fov = Fov::calc(map, Pos2(0, 0), radius);
+	CHECK(fov.get_offset() == Pos2(0, 0));
+	CHECK(fov.get_size() == Pos2(radius + 1));
+	CHECK(fov.get(Pos2(radius, 0)) != 0);
+
+	// paths reach the last tile within range on the far side as well as the near one
+	PathSettings settings;
+	float move = 3;
+	PathMap path = Path::calc(map, Pos2(8, 8), move, settings);
+	int reach = (int)move + 1;
+	CHECK(path.can_access(Pos2(8 + reach, 8)));
+	CHECK(path.can_access(Pos2(8, 8 + reach)));
+	CHECK(path.can_access(Pos2(8 - reach, 8)));
+	CHECK(!path.can_access(Pos2(8 + reach + 1, 8)));
+
+	// and stop at the map edge
+	path = Path::calc(map, Pos2(19, 19), move, settings);
+	CHECK(path.can_access(Pos2(19, 19 - reach)));
+	CHECK(path.can_access(Pos2(19 - reach, 19)));
+	CHECK(!path.can_access(Pos2(20, 19)));
+	CHECK(path.get_node(Pos2(20, 19)) == nullptr);
+
+	return test_result();
+}
@@ -0,0 +1,95 @@
+#include <vector>
+#include "Check.h"
+#include "map/ChangeLog.h"
+
+static MapChange wall(Pos2 pos) {
+	return MapChange(MapChange::Type::Wall, pos, pos);
+}
+
+static MapChange move(UnitHandle unit, Pos2 from, Pos2 to) {
+	MapChange change(MapChange::Type::UnitMoved, from.min(to), from.max(to), unit);
+	change.from = from;
+	change.to = to;
+	return change;
+}
+
+static std::vector<MapChange> drain(ChangeLog& log, ChangeLog::Subscriber subscriber) {
+	std::vector<MapChange> drained;
+	log.drain(subscriber, [&](const MapChange& change) { drained.push_back(change); });
+	return drained;
+}
+
+int main() {
+	ChangeLog log;
+	UnitHandle unit(0, 0), other(1, 0);
+
+	// nothing is kept without subscribers
+	log.push(wall(Pos2(1, 1)));
+	CHECK(log.size() == 0);
+
+	ChangeLog::Subscriber fast = log.subscribe();
+	ChangeLog::Subscriber slow = log.subscribe();
+	CHECK(!log.has_changes(fast));
+
+	// repeated moves of one unit merge into a single move from its start to where it ended up
+	log.push(move(unit, Pos2(2, 2), Pos2(3, 2)));
+	log.push(move(unit, Pos2(3, 2), Pos2(4, 5)));
+	log.push(move(unit, Pos2(4, 5), Pos2(1, 4)));
+	CHECK(log.size() == 1);
+	// but not across another unit's move or other changes
+	log.push(move(other, Pos2(9, 9), Pos2(8, 9)));
+	log.push(move(unit, Pos2(1, 4), Pos2(1, 3)));
+	log.push(wall(Pos2(20, 20)));
+	CHECK(log.size() == 4);
+
+	std::vector<MapChange> drained = drain(log, fast);
+	CHECK(drained.size() == 4);
+	CHECK(drained[0].type == MapChange::Type::UnitMoved && drained[0].unit == unit);
+	CHECK(drained[0].from == Pos2(2, 2) && drained[0].to == Pos2(1, 4));
+	CHECK(drained[0].top_left == Pos2(1, 2) && drained[0].bot_rite == Pos2(4, 5));
+	CHECK(drained[1].unit == other && drained[3].type == MapChange::Type::Wall);
+	CHECK(!log.has_changes(fast));
+	CHECK(log.has_changes(slow));
+
+	// the slowest cursor keeps everything it hasn't drained
+	CHECK(log.size() == 4);
+
+	// nothing merges into an entry a subscriber has already seen
+	log.push(wall(Pos2(20, 21)));
+	log.push(move(unit, Pos2(1, 3), Pos2(1, 2)));
+	log.push(move(unit, Pos2(1, 2), Pos2(1, 1)));
+	CHECK(log.size() == 6);
+	drained = drain(log, fast);
+	CHECK(drained.size() == 2);
+	CHECK(drained[1].from == Pos2(1, 3) && drained[1].to == Pos2(1, 1));
+
+	// a late subscriber only sees what comes after it
+	ChangeLog::Subscriber late = log.subscribe();
+	CHECK(!log.has_changes(late));
+	log.push(wall(Pos2(30, 30)));
+	CHECK(drain(log, late).size() == 1);
+
+	// the slow subscriber still gets everything, then the log trims up to the next slowest
+	drained = drain(log, slow);
+	CHECK(drained.size() == 7);
+	CHECK(drained[0].from == Pos2(2, 2) && drained[0].to == Pos2(1, 4));
+	CHECK(log.size() == 1);
+	CHECK(log.has_changes(fast));
+	drain(log, fast);
+	CHECK(log.size() == 0);
+
+	// unsubscribing the slowest releases what only it was waiting for
+	log.push(wall(Pos2(40, 40)));
+	drain(log, fast);
+	drain(log, slow);
+	CHECK(log.size() == 1);
+	log.unsubscribe(late);
+	CHECK(log.size() == 0);
+
+	// a freed subscriber id is handed out again, starting from now
+	ChangeLog::Subscriber reused = log.subscribe();
+	CHECK(reused == late);
+	CHECK(!log.has_changes(reused));
+
+	return test_result();
+}
@@ -0,0 +1,22 @@
+#ifndef SPENCE_CHECK_H
+#define SPENCE_CHECK_H
+
+#include <iostream>
+
+/// Minimal assertions for the test programs: failures are counted and reported rather than
+/// aborting, and main returns test_result() so ctest sees them.
+static int num_failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		std::cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+		num_failures++; \
+	} \
+} while (0)
+
+static inline int test_result() {
+	if (num_failures > 0) std::cout << num_failures << " checks failed" << std::endl;
+	return num_failures > 0 ? 1 : 0;
+}
+
+#endif //SPENCE_CHECK_H
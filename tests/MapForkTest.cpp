@@ -0,0 +1,121 @@
+#include <vector>
+#include "Check.h"
+#include "map/Map.h"
+#include "map/CowGrid.h"
+#include "util/CowArray.h"
+
+static void test_cow_array() {
+	CowArray<int, 4> parent(10, 1);
+	CowArray<int, 4> copy = parent;
+	CHECK(copy.shares_chunk(parent, 0) && copy.shares_chunk(parent, 2));
+
+	// a write unshares only the chunk written to, and never shows through to the other copy
+	copy.set(5, 7);
+	CHECK(copy[5] == 7 && parent[5] == 1);
+	CHECK(copy.shares_chunk(parent, 0) && !copy.shares_chunk(parent, 1) && copy.shares_chunk(parent, 2));
+	parent.mut(0) = 3;
+	CHECK(parent[0] == 3 && copy[0] == 1);
+
+	// growing and shrinking one copy leaves the other's size and contents alone
+	copy.push_back(9);
+	copy.resize(20, 2);
+	CHECK(copy.size() == 20 && parent.size() == 10);
+	CHECK(copy[10] == 9 && copy[19] == 2);
+	parent.pop_back();
+	parent.pop_back();
+	CHECK(parent.size() == 8 && copy.size() == 20 && copy[9] == 1);
+
+	// chunks filled by resize share one copy until written
+	CowArray<int, 4> filled(16, 5);
+	filled.set(13, 6);
+	CHECK(filled[12] == 5 && filled[13] == 6 && filled[1] == 5);
+}
+
+static void test_cow_grid() {
+	CowGrid<short, 4> parent(Pos2(10, 9), -1);
+	parent.set(Pos2(1, 1), 4);
+	CowGrid<short, 4> copy = parent;
+	copy.set(Pos2(9, 8), 5);
+	CHECK(copy.get(Pos2(9, 8)) == 5 && parent.get(Pos2(9, 8)) == -1);
+	CHECK(copy.get(Pos2(1, 1)) == 4);
+	CHECK(copy.shares_chunk(parent, Pos2(1, 1)) && !copy.shares_chunk(parent, Pos2(9, 8)));
+	CHECK(parent.get(Pos2(10, 0)) == -1);
+}
+
+/// Everything a fork copies, compared tile by tile.
+static bool same_state(const Map& a, const Map& b) {
+	if (a.get_size() != b.get_size() || a.get_hash() != b.get_hash()) return false;
+	if (a.get_units().size() != b.get_units().size()) return false;
+	for (int y = 0; y < a.get_size().y; y++) {
+		for (int x = 0; x < a.get_size().x; x++) {
+			Pos2 pos(x, y);
+			if (a.get_wall(pos, Dir::North) != b.get_wall(pos, Dir::North)) return false;
+			if (a.get_wall(pos, Dir::West) != b.get_wall(pos, Dir::West)) return false;
+			if (a.is_lit(pos) != b.is_lit(pos)) return false;
+			const Unit ua = a.get_unit(pos);
+			const Unit ub = b.get_unit(pos);
+			if ((bool)ua != (bool)ub) return false;
+			if (ua && (ua.handle() != ub.handle() || ua.hp() != ub.hp() || ua.ap() != ub.ap())) return false;
+		}
+	}
+	return true;
+}
+
+static void test_map_fork() {
+	UnitType type("Test", 5, 5, 8);
+	Map parent;
+	parent.reset(Pos2(40, 40));
+	parent.set_wall(Pos2(3, 3), Dir::North, Wall::Blocking);
+	parent.add_light(Pos2(10, 10));
+	Unit unit = parent.create_unit(type, Side::You, Pos2(5, 5));
+	parent.create_unit(type, Side::Enemy, Pos2(30, 30));
+
+	Map before = parent.fork();
+	CHECK(same_state(before, parent));
+
+	// writes to one fork change neither the parent nor a sibling
+	Map first = parent.fork();
+	Map second = parent.fork();
+	first.set_wall(Pos2(20, 20), Dir::West, Wall::Cover);
+	first.add_light(Pos2(35, 5));
+	Unit moved = first.get_unit(unit.handle());
+	first.move(moved, Pos2(6, 7));
+	moved.damage(3);
+	moved.set_ap(1);
+	first.create_unit(type, Side::Enemy, Pos2(25, 25));
+	second.set_wall(Pos2(3, 3), Dir::North, Wall::None);
+	second.remove_unit(second.get_unit(Pos2(30, 30)));
+
+	CHECK(same_state(before, parent));
+	CHECK(parent.get_wall(Pos2(20, 20), Dir::West) == Wall::None);
+	CHECK(!parent.is_lit(Pos2(35, 5)));
+	CHECK(parent.get_unit(Pos2(5, 5)) && !parent.get_unit(Pos2(6, 7)));
+	CHECK(parent.get_unit(unit.handle()).hp() == 8);
+	CHECK(parent.get_units().size() == 2);
+	std::vector<UnitHandle> nearest = parent.get_unit_index().nearest(Side::You, Pos2(6, 7), 1);
+	CHECK(nearest.size() == 1 && parent.get_unit(nearest[0]).pos() == Pos2(5, 5));
+
+	CHECK(second.get_wall(Pos2(20, 20), Dir::West) == Wall::None);
+	CHECK(second.get_unit(Pos2(5, 5)) && second.get_unit(unit.handle()).hp() == 8);
+	CHECK(second.get_units().size() == 1);
+	CHECK(first.get_wall(Pos2(3, 3), Dir::North) == Wall::Blocking);
+	CHECK(first.get_unit(Pos2(30, 30)));
+	CHECK(first.get_hash() != parent.get_hash() && second.get_hash() != parent.get_hash());
+
+	// restore brings back the snapshot, and later writes don't leak into it
+	parent.restore(first);
+	CHECK(same_state(parent, first));
+	parent.restore(before);
+	CHECK(same_state(parent, before));
+	parent.set_wall(Pos2(1, 1), Dir::West, Wall::Blocking);
+	parent.get_unit(unit.handle()).damage(1);
+	CHECK(before.get_wall(Pos2(1, 1), Dir::West) == Wall::None);
+	CHECK(before.get_unit(unit.handle()).hp() == 8);
+}
+
+int main() {
+	test_cow_array();
+	test_cow_grid();
+	test_map_fork();
+	return test_result();
+}
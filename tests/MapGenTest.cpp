@@ -0,0 +1,77 @@
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "game/Game.h"
+#include "map/MapGen.h"
+
+static bool same_maps(const Map& a, const Map& b) {
+	if (a.get_size() != b.get_size() || a.get_hash() != b.get_hash()) return false;
+	for (int y = 0; y < a.get_size().y; y++) {
+		for (int x = 0; x < a.get_size().x; x++) {
+			Pos2 pos(x, y);
+			const Tile& ta = a.get_tile(pos);
+			const Tile& tb = b.get_tile(pos);
+			if (ta.north_wall != tb.north_wall || ta.west_wall != tb.west_wall || ta.type != tb.type) return false;
+			if (a.is_lit(pos) != b.is_lit(pos)) return false;
+		}
+	}
+	return true;
+}
+
+/// Side, position and type of every unit, as text that can outlive the game owning the types.
+static std::string spawns(const Map& map) {
+	const UnitStore& units = map.get_units();
+	std::string text;
+	for (size_t i = 0; i < units.size(); i++) {
+		text += std::to_string((int)units.side(i)) + " " + std::to_string(units.pos(i).x) + "," +
+		        std::to_string(units.pos(i).y) + " " + units.type(i).name + "\n";
+	}
+	return text;
+}
+
+int main() {
+	// several regions each way, with one left over at the edges
+	MapGenSettings settings;
+	settings.size = Pos2(150, 110);
+	settings.region_size = 32;
+	settings.rect_density *= 4;
+	settings.light_density *= 4;
+
+	for (uint64_t seed : { 1, 2, 3 }) {
+		settings.threads = 1;
+		Map single;
+		MapGen::generate(single, seed, settings);
+		for (unsigned threads : { 2, 3, 8 }) {
+			settings.threads = threads;
+			Map parallel;
+			MapGen::generate(parallel, seed, settings);
+			CHECK(same_maps(single, parallel));
+		}
+	}
+
+	// different seeds give different maps
+	settings.threads = 1;
+	Map first, second;
+	MapGen::generate(first, 1, settings);
+	MapGen::generate(second, 2, settings);
+	CHECK(!same_maps(first, second));
+
+	// and the units a game spawns on them land in the same places
+	std::vector<Map> maps(2);
+	std::vector<std::string> units(2);
+	for (size_t i = 0; i < maps.size(); i++) {
+		Scenario scenario;
+		Scenario::preset("large", scenario);
+		scenario.gen.threads = i == 0 ? 1 : 8;
+		UI ui;
+		Game game(maps[i], ui, 42);
+		game.set_scenario(scenario);
+		game.init();
+		units[i] = spawns(maps[i]);
+	}
+	CHECK(same_maps(maps[0], maps[1]));
+	CHECK(units[0] == units[1]);
+	CHECK(!units[0].empty());
+
+	return test_result();
+}
@@ -0,0 +1,190 @@
+#include <chrono>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+#include "Check.h"
+#include "util/Rando.h"
+
+// Pearson's chi-square of rand(0, buckets) against the uniform distribution.
+static double chi_square(Rando& rando, int64_t buckets, size_t draws, bool bulk) {
+	std::vector<size_t> counts((size_t)buckets, 0);
+	if (bulk) {
+		std::vector<int64_t> values(draws);
+		rando.fill(values.data(), draws, 0, buckets);
+		for (int64_t value : values) {
+			if (value < 0 || value >= buckets) return 1e9;
+			counts[(size_t)value]++;
+		}
+	} else {
+		for (size_t i = 0; i < draws; i++) {
+			int64_t value = rando.rand(0, buckets);
+			if (value < 0 || value >= buckets) return 1e9;
+			counts[(size_t)value]++;
+		}
+	}
+	double expected = (double)draws / buckets;
+	double chi = 0;
+	for (size_t count : counts) {
+		chi += (count - expected) * (count - expected) / expected;
+	}
+	return chi;
+}
+
+static void test_uniform() {
+	// critical values at p = 0.001 for buckets - 1 degrees of freedom
+	struct Case { int64_t buckets; double critical; };
+	for (Case c : { Case { 8, 24.32 }, Case { 10, 27.88 }, Case { 6, 20.52 }, Case { 37, 67.99 } }) {
+		Rando rando((uint64_t)c.buckets);
+		double single = chi_square(rando, c.buckets, 1000000, false);
+		double bulk = chi_square(rando, c.buckets, 1000000, true);
+		std::cout << "chi-square over " << c.buckets << " buckets: " << single << " single, " << bulk
+		          << " bulk, critical " << c.critical << std::endl;
+		CHECK(single < c.critical);
+		CHECK(bulk < c.critical);
+	}
+
+	// a range just over half of 2^64 rejects almost half of the raw draws, so bias would show
+	Rando rando(3);
+	uint64_t range = (1ull << 63) + (1ull << 62);
+	size_t low_third = 0;
+	const size_t draws = 300000;
+	for (size_t i = 0; i < draws; i++) {
+		uint64_t value = (uint64_t)rando.rand(INT64_MIN, (int64_t)((uint64_t)INT64_MIN + range)) - (uint64_t)INT64_MIN;
+		CHECK(value < range);
+		if (value < range / 3) low_third++;
+	}
+	double share = (double)low_third / draws;
+	CHECK(share > 0.33 && share < 0.337);
+
+	Rando same(4);
+	CHECK(same.rand(5, 5) == 5);
+	CHECK(same.rand(-3, -2) == -3);
+}
+
+static void test_streams() {
+	// no value from one stream shows up in another, which it would if they overlapped
+	Rando source(5);
+	std::unordered_set<uint64_t> seen;
+	const size_t num_streams = 8, draws = 100000;
+	size_t total = 0;
+	for (size_t i = 0; i < num_streams; i++) {
+		Rando stream = source.split();
+		for (size_t j = 0; j < draws; j++) {
+			seen.insert(stream.rand());
+			total++;
+		}
+	}
+	Rando far = source;
+	far.long_jump();
+	for (size_t j = 0; j < draws; j++) {
+		seen.insert(far.rand());
+		total++;
+	}
+	CHECK(seen.size() == total);
+
+	// jumps are linear in the state, so they commute with stepping the generator
+	for (bool is_long : { false, true }) {
+		Rando a(6), b(6);
+		a.rand();
+		is_long ? a.long_jump() : a.jump();
+		is_long ? b.long_jump() : b.jump();
+		b.rand();
+		CHECK(a.rand() == b.rand());
+	}
+
+	// split hands out the same streams in the same order for the same seed
+	Rando x(7), y(7);
+	for (int i = 0; i < 4; i++) {
+		CHECK(x.split().rand() == y.split().rand());
+	}
+	Rando first(7);
+	CHECK(Rando(7).split().rand() == first.rand());
+}
+
+static void test_fills() {
+	Rando a(8), b(8);
+	std::vector<uint64_t> raw(1000);
+	a.fill(raw.data(), raw.size());
+	bool same = true;
+	for (uint64_t value : raw) same &= value == b.rand();
+	CHECK(same);
+
+	std::vector<double> floats(1000);
+	a.fill_float(floats.data(), floats.size());
+	same = true;
+	for (double value : floats) same &= value == b.rand_float() && value >= 0 && value < 1;
+	CHECK(same);
+}
+
+static void test_lanes() {
+	// lane k gives exactly the kth split() stream, through raw and float fills and afterwards
+	Rando source(10), reference(10);
+	RandoLanes lanes(source);
+	Rando streams[RandoLanes::LANES] = { reference.split(), reference.split(), reference.split(), reference.split() };
+	CHECK(source.rand() == reference.rand());
+
+	const size_t draws = 1000;
+	std::vector<uint64_t> raw(draws * RandoLanes::LANES);
+	lanes.fill(raw.data(), raw.size());
+	bool same = true;
+	for (size_t k = 0; k < draws; k++) {
+		for (size_t i = 0; i < RandoLanes::LANES; i++) same &= raw[k * RandoLanes::LANES + i] == streams[i].rand();
+	}
+	CHECK(same);
+
+	std::vector<double> floats(draws * RandoLanes::LANES);
+	lanes.fill_float(floats.data(), floats.size());
+	same = true;
+	for (size_t k = 0; k < draws; k++) {
+		for (size_t i = 0; i < RandoLanes::LANES; i++) same &= floats[k * RandoLanes::LANES + i] == streams[i].rand_float();
+	}
+	CHECK(same);
+
+	for (size_t i = 0; i < RandoLanes::LANES; i++) {
+		CHECK(lanes.lane(i).rand() == streams[i].rand());
+	}
+}
+
+template<typename F>
+static double per_second(size_t count, F fn) {
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return count / std::max(seconds, 1e-9);
+}
+
+static void test_throughput() {
+	const size_t count = 10000000;
+	std::vector<uint64_t> raw(count);
+	std::vector<int64_t> bounded(count);
+	Rando rando(9);
+	uint64_t sink = 0;
+
+	double single = per_second(count, [&]() { for (size_t i = 0; i < count; i++) sink += rando.rand(); });
+	double ranged = per_second(count, [&]() { for (size_t i = 0; i < count; i++) sink += rando.rand(0, 10); });
+	double modulo = per_second(count, [&]() { for (size_t i = 0; i < count; i++) sink += rando.rand() % 10; });
+	double bulk = per_second(count, [&]() { rando.fill(raw.data(), count); });
+	double bulk_ranged = per_second(count, [&]() { rando.fill(bounded.data(), count, 0, 10); });
+	RandoLanes lanes(rando);
+	double laned = per_second(count, [&]() { lanes.fill(raw.data(), count); });
+	std::cout << "millions per second: rand() " << single / 1e6 << ", rand(0, 10) " << ranged / 1e6
+	          << ", rand() % 10 " << modulo / 1e6 << ", fill " << bulk / 1e6 << ", bounded fill "
+	          << bulk_ranged / 1e6 << ", lanes " << laned / 1e6 << " (" << sink % 2 << ")" << std::endl;
+
+	// loose floors that still hold in unoptimised builds; a regression to per-call division or an
+	// allocation per draw would fall well below them
+	CHECK(single > 10e6);
+	CHECK(ranged > 5e6);
+	CHECK(bulk > single / 2);
+	CHECK(bulk_ranged > ranged / 2);
+	CHECK(laned > 10e6);
+}
+
+int main() {
+	test_uniform();
+	test_streams();
+	test_fills();
+	test_lanes();
+	test_throughput();
+	return test_result();
+}
@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "Check.h"
+#include "SoftwareRenderer.h"
+#include "map/Fov.h"
+#include "map/MapGen.h"
+
+// Hash of the golden frame below. When a change to the renderer or map generator is meant to
+// change the output, look at the PPM the failing test writes and paste its hash here.
+static const uint64_t GOLDEN_HASH = 0x6d2ef327611c16e5ull;
+
+/// FNV-1a over the RGB of every pixel.
+static uint64_t hash_pixels(const std::vector<uint8_t>& pixels) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < pixels.size(); i++) {
+		if (i % 4 == 3) continue;
+		hash = (hash ^ pixels[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+int main() {
+	MapGenSettings settings;
+	settings.size = Pos2(40, 30);
+	settings.threads = 1;
+	Map map;
+	MapGen::generate(map, 1234, settings);
+
+	UnitType type("Test", 6, 6, 6);
+	std::vector<Pos2> spawns = { Pos2(5, 5), Pos2(7, 6), Pos2(30, 22), Pos2(33, 20) };
+	std::vector<UnitHandle> handles;
+	for (size_t i = 0; i < spawns.size(); i++) {
+		Unit unit = map.create_unit(type, i < 2 ? Side::You : Side::Enemy, spawns[i]);
+		unit.set_ap(3);
+		unit.set_fov(Fov::calc(map, unit.pos(), 12));
+		handles.push_back(unit.handle());
+	}
+
+	SoftwareRenderer renderer(Pos2(320, 240), 0, map);
+	map.set_renderer(renderer);
+	renderer.select(handles[0]);
+	renderer.render();
+	uint64_t hash = hash_pixels(renderer.get_pixels());
+
+	// the same scene renders the same again, in this renderer and a fresh one
+	renderer.render();
+	CHECK(hash_pixels(renderer.get_pixels()) == hash);
+	SoftwareRenderer other(Pos2(320, 240), 0, map);
+	other.select(handles[0]);
+	other.render();
+	CHECK(hash_pixels(other.get_pixels()) == hash);
+
+	// and matches the stored golden frame
+	if (hash != GOLDEN_HASH) {
+		std::cout << "frame hash 0x" << std::hex << hash << std::dec << " differs from the golden 0x" << std::hex
+		          << GOLDEN_HASH << std::dec << "; wrote SoftwareRendererTest.ppm" << std::endl;
+		renderer.save_ppm("SoftwareRendererTest.ppm");
+	}
+	CHECK(hash == GOLDEN_HASH);
+
+	// what's on the map does show up in the frame
+	renderer.select(UnitHandle());
+	renderer.render();
+	CHECK(hash_pixels(renderer.get_pixels()) != hash);
+
+	return test_result();
+}
@@ -0,0 +1,78 @@
+#include "Check.h"
+#include "UnitStore.h"
+
+int main() {
+	UnitType soldier("Soldier", 5, 5, 10);
+	UnitType sniper("Sniper", 4, 8, 6);
+
+	// the incremental hash tracks a from-scratch recompute through every mutation
+	UnitStore store;
+	UnitHandle a = store.create(soldier, Side::You, Pos2(1, 1));
+	store.create(sniper, Side::You, Pos2(2, 1));
+	UnitHandle c = store.create(soldier, Side::Enemy, Pos2(8, 8));
+	CHECK(store.get_hash() == store.compute_hash());
+	store.set_ap(store.index(a), 2);
+	CHECK(store.get_hash() == store.compute_hash());
+	store.set_pos(store.index(a), Pos2(3, 4));
+	CHECK(store.get_hash() == store.compute_hash());
+	store.spend_move(store.index(a), 2);
+	CHECK(store.get_hash() == store.compute_hash());
+	store.damage(store.index(c), 4);
+	CHECK(store.get_hash() == store.compute_hash());
+	store.destroy(a);
+	CHECK(store.get_hash() == store.compute_hash());
+	UnitHandle d = store.create(sniper, Side::Enemy, Pos2(5, 5));
+	CHECK(store.get_hash() == store.compute_hash());
+	store.destroy(c);
+	CHECK(store.get_hash() == store.compute_hash());
+	store.clear();
+	CHECK(store.get_hash() == 0);
+
+	// the same units in the same places hash the same whatever the history or creation order
+	UnitStore history;
+	a = history.create(soldier, Side::You, Pos2(1, 1));
+	history.create(sniper, Side::You, Pos2(2, 1));
+	c = history.create(soldier, Side::Enemy, Pos2(8, 8));
+	history.destroy(a);
+	d = history.create(sniper, Side::Enemy, Pos2(0, 0));
+	history.set_pos(history.index(d), Pos2(5, 5));
+	history.damage(history.index(c), 4);
+
+	UnitStore direct;
+	UnitHandle e = direct.create(soldier, Side::Enemy, Pos2(8, 8));
+	direct.create(sniper, Side::Enemy, Pos2(5, 5));
+	direct.create(sniper, Side::You, Pos2(2, 1));
+	direct.damage(direct.index(e), 4);
+	CHECK(history.get_hash() == direct.get_hash());
+
+	// but any difference in state shows up
+	direct.damage(direct.index(e), 1);
+	CHECK(history.get_hash() != direct.get_hash());
+	direct.damage(direct.index(e), -1);
+	direct.set_pos(direct.index(e), Pos2(8, 7));
+	CHECK(history.get_hash() != direct.get_hash());
+
+	// units of different types are told apart
+	UnitStore swapped;
+	swapped.create(sniper, Side::Enemy, Pos2(8, 8));
+	swapped.create(soldier, Side::Enemy, Pos2(5, 5));
+	UnitStore original;
+	original.create(soldier, Side::Enemy, Pos2(8, 8));
+	original.create(sniper, Side::Enemy, Pos2(5, 5));
+	CHECK(swapped.get_hash() != original.get_hash());
+
+	// a side's FOV version only moves with its own units
+	UnitStore sides;
+	UnitHandle friendly = sides.create(soldier, Side::You, Pos2(1, 1));
+	UnitHandle enemy = sides.create(soldier, Side::Enemy, Pos2(8, 8));
+	uint64_t your_version = sides.get_fov_version(Side::You);
+	uint64_t version = sides.get_fov_version();
+	sides.set_fov(sides.index(enemy), Grid<char>(Pos2(3, 3), 1, Pos2(7, 7)));
+	sides.destroy(enemy);
+	CHECK(sides.get_fov_version(Side::You) == your_version);
+	CHECK(sides.get_fov_version() != version);
+	sides.set_fov(sides.index(friendly), Grid<char>(Pos2(3, 3), 1, Pos2(0, 0)));
+	CHECK(sides.get_fov_version(Side::You) != your_version);
+
+	return test_result();
+}